@@ -0,0 +1,114 @@
+/*
+ * base64.cpp
+ *
+ * Measures the throughput of base64 encoding and decoding, in GB/s of binary data, with the scalar tables (the build with BASE64_NO_SIMD),
+ * with the kernels the library selects for this CPU, and with every vectorized kernel on its own.
+ *
+ * Usage: base64 [size in bytes]
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base64.hpp"
+#include "base64_reference.hpp"
+
+namespace
+{
+    /// <summary>
+    /// Runs a function over the data until at least half a second has passed, and returns the throughput in GB/s.
+    /// </summary>
+    template< typename Function >
+    double measure( const std::size_t bytes, Function&& function )
+    {
+        using clock = std::chrono::steady_clock;
+
+        // One untimed run, so that the caches and the allocator are warm.
+        function();
+
+        std::size_t runs = 0;
+        const auto start = clock::now();
+        auto elapsed = clock::duration::zero();
+
+        do
+        {
+            function();
+            ++runs;
+            elapsed = clock::now() - start;
+        } while ( elapsed < std::chrono::milliseconds( 500 ) );
+
+        return static_cast< double >( bytes * runs ) / std::chrono::duration< double >( elapsed ).count() / 1e9;
+    }
+
+    void report( const char* name, const double encode, const double decode )
+    {
+        std::printf( "%-28s %8.2f GB/s %8.2f GB/s\n", name, encode, decode );
+    }
+
+    /// <summary>
+    /// Keeps the optimizer from dropping the work whose result is never used.
+    /// </summary>
+    volatile std::size_t sink;
+}  // namespace
+
+int main( int argc, char** argv )
+{
+    const std::size_t size = argc > 1 ? std::strtoull( argv[ 1 ], nullptr, 10 ) / 3 * 3 : std::size_t{ 1 } << 20;
+
+    std::mt19937_64 random( 0xB64 );
+    std::string bytes( size, '\0' );
+
+    for ( auto& c : bytes )
+        c = static_cast< char >( random() );
+
+    const auto text = base64::to_base64( bytes );
+
+    std::printf( "%zu bytes, %zu characters\n\n%-28s %13s %13s\n", bytes.size(), text.size(), "", "encode", "decode" );
+
+    report(
+        "scalar (BASE64_NO_SIMD)",
+        measure( size, [ & ] { sink = reference::encode( bytes ).size(); } ),
+        measure( size, [ & ] { sink = reference::decode( text ).data.size(); } ) );
+
+    std::string decoded;
+
+    report(
+        "library on this CPU",
+        measure( size, [ & ] { sink = base64::to_base64( bytes ).size(); } ),
+        measure( size, [ & ] { sink = base64::try_decode_to( text, decoded ).value_or( 0 ); } ) );
+
+    // The kernels alone, on the bulk of the data and into buffers that are reused.
+    std::vector< char > encoded( text.size() ), output( size );
+    const auto data = reinterpret_cast< const std::uint8_t* >( bytes.data() );
+    const auto characters = reinterpret_cast< const std::uint8_t* >( text.data() );
+
+    const auto kernel = [ & ]( const char* name, base64::detail::simd::encode_t encode, base64::detail::simd::decode_t decode )
+    {
+        report(
+            name,
+            measure( size, [ & ] { sink = encode( data, size, encoded.data() ); } ),
+            measure( size, [ & ] { sink = decode( characters, text.size(), output.data() ); } ) );
+    };
+
+#if defined( BASE64_SIMD_X86 )
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports( "sse4.1" ) )
+        kernel( "sse4.1 kernel", base64::detail::simd::encode_sse41, base64::detail::simd::decode_sse41 );
+
+    if ( __builtin_cpu_supports( "avx2" ) )
+        kernel( "avx2 kernel", base64::detail::simd::encode_avx2, base64::detail::simd::decode_avx2 );
+#elif defined( BASE64_SIMD_NEON )
+    kernel( "neon kernel", base64::detail::simd::encode_neon, base64::detail::simd::decode_neon );
+#else
+    ( void )kernel;
+#endif
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * hash.cpp
+ *
+ * Measures how fast a binary is hashed, in MB/s, on generated files of 10 to 500 MB. Every file is hashed with the path the SDK takes for
+ * the executable, mapped into memory and fed to the EVP digest in one call, and with the fallback that reads it in chunks. Both must give
+ * the same hash. The files were just written, so they are read from the page cache: this measures the hashing, not the disk.
+ *
+ * Usage: hash [directory] [size in MB...]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "system.hpp"
+
+namespace
+{
+    bool generate( const std::filesystem::path& path, const std::size_t megabytes )
+    {
+        std::mt19937_64 random( megabytes );
+        std::vector< std::uint64_t > block( 1024 * 1024 / sizeof( std::uint64_t ) );
+
+        std::ofstream file( path, std::ios::binary | std::ios::trunc );
+
+        for ( std::size_t i = 0; i < megabytes && file; ++i )
+        {
+            for ( auto& word : block )
+                word = random();
+
+            file.write( reinterpret_cast< const char* >( block.data() ), static_cast< std::streamsize >( block.size() * sizeof( std::uint64_t ) ) );
+        }
+
+        return static_cast< bool >( file );
+    }
+
+    /// <summary>
+    /// Hashes the file a few times and returns the best throughput in MB/s, along with the hash.
+    /// </summary>
+    double measure( const std::string& path, const std::size_t megabytes, const bool mapped, std::string& hash )
+    {
+        using clock = std::chrono::steady_clock;
+
+        auto best = clock::duration::max();
+
+        for ( int run = 0; run < 3; ++run )
+        {
+            const auto start = clock::now();
+            hash = tsar::system::hash_file( path, mapped );
+            best = std::min( best, clock::now() - start );
+        }
+
+        return static_cast< double >( megabytes ) / std::chrono::duration< double >( best ).count();
+    }
+}  // namespace
+
+int main( int argc, char** argv )
+{
+    const std::filesystem::path directory = argc > 1 ? std::filesystem::path( argv[ 1 ] ) : std::filesystem::temp_directory_path();
+
+    std::vector< std::size_t > sizes;
+
+    for ( int i = 2; i < argc; ++i )
+        sizes.push_back( std::strtoull( argv[ i ], nullptr, 10 ) );
+
+    if ( sizes.empty() )
+        sizes = { 10, 50, 100, 250, 500 };
+
+    std::printf( "%8s %14s %14s\n", "MB", "mapped MB/s", "read MB/s" );
+
+    int status = 0;
+
+    for ( const auto megabytes : sizes )
+    {
+        const auto path = directory / ( "tsar-hash-benchmark-" + std::to_string( megabytes ) );
+
+        if ( !generate( path, megabytes ) )
+        {
+            std::fprintf( stderr, "Failed to write %s.\n", path.string().c_str() );
+            std::filesystem::remove( path );
+            return 1;
+        }
+
+        std::string mapped_hash, read_hash;
+        const auto mapped = measure( path.string(), megabytes, true, mapped_hash );
+        const auto read = measure( path.string(), megabytes, false, read_hash );
+
+        std::filesystem::remove( path );
+
+        std::printf( "%8zu %14.0f %14.0f\n", megabytes, mapped, read );
+
+        if ( mapped_hash.empty() || mapped_hash != read_hash )
+        {
+            std::fprintf( stderr, "The hashes of the %zu MB file differ: %s and %s.\n", megabytes, mapped_hash.c_str(), read_hash.c_str() );
+            status = 1;
+        }
+    }
+
+    return status;
+}
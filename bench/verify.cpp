@@ -0,0 +1,207 @@
+/*
+ * verify.cpp
+ *
+ * Measures how many response signatures are verified per second. "before" is the verification of the original SDK, which parsed the key
+ * and built the DER signature through OpenSSL big numbers on every call. "after" is `crypto::key::verify`, with the key parsed once and
+ * its verification contexts reused. Both run over 1, 8 and 64 keys in turn, on 1 and 4 threads.
+ *
+ * Usage: verify [seconds per run]
+ */
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "crypto/key.hpp"
+
+namespace
+{
+    /// <summary>
+    /// A signing key, with its public key in DER and a signature of the message in raw (r||s) format.
+    /// </summary>
+    struct signer_t
+    {
+        std::string public_key, signature;
+    };
+
+    signer_t make_signer( const std::string_view message )
+    {
+        signer_t signer;
+
+        const auto pkey = EVP_EC_gen( "P-256" );
+
+        if ( !pkey )
+            return signer;
+
+        unsigned char* der = nullptr;
+        const auto der_size = i2d_PUBKEY( pkey, &der );
+        signer.public_key.assign( reinterpret_cast< const char* >( der ), static_cast< std::size_t >( der_size ) );
+        OPENSSL_free( der );
+
+        const auto context = EVP_MD_CTX_new();
+        std::size_t signature_size = 0;
+        std::vector< unsigned char > signature;
+
+        if ( EVP_DigestSignInit( context, nullptr, EVP_sha256(), nullptr, pkey ) == 1 &&
+             EVP_DigestSign( context, nullptr, &signature_size, reinterpret_cast< const unsigned char* >( message.data() ), message.size() ) == 1 )
+        {
+            signature.resize( signature_size );
+            EVP_DigestSign( context, signature.data(), &signature_size, reinterpret_cast< const unsigned char* >( message.data() ), message.size() );
+        }
+
+        EVP_MD_CTX_free( context );
+        EVP_PKEY_free( pkey );
+
+        // The API sends r and s as two 32-byte big-endian integers.
+        const unsigned char* data = signature.data();
+        const auto parsed = d2i_ECDSA_SIG( nullptr, &data, static_cast< long >( signature_size ) );
+
+        if ( parsed )
+        {
+            signer.signature.resize( 64 );
+            BN_bn2binpad( ECDSA_SIG_get0_r( parsed ), reinterpret_cast< unsigned char* >( signer.signature.data() ), 32 );
+            BN_bn2binpad( ECDSA_SIG_get0_s( parsed ), reinterpret_cast< unsigned char* >( signer.signature.data() ) + 32, 32 );
+            ECDSA_SIG_free( parsed );
+        }
+
+        return signer;
+    }
+
+    /// <summary>
+    /// The verification of the original SDK.
+    /// </summary>
+    bool verify_before( const std::string_view key, const std::string_view message, const std::string_view signature )
+    {
+        const auto* data = reinterpret_cast< const std::uint8_t* >( key.data() );
+        const auto pkey = d2i_PUBKEY( nullptr, &data, static_cast< long >( key.size() ) );
+
+        if ( !pkey )
+            return false;
+
+        const auto ecdsa_sig = ECDSA_SIG_new();
+        const auto half = static_cast< int >( signature.size() / 2 );
+
+        ECDSA_SIG_set0( ecdsa_sig,
+                        BN_bin2bn( reinterpret_cast< const std::uint8_t* >( signature.data() ), half, nullptr ),
+                        BN_bin2bn( reinterpret_cast< const std::uint8_t* >( signature.data() ) + half, half, nullptr ) );
+
+        std::vector< std::uint8_t > der( static_cast< std::size_t >( i2d_ECDSA_SIG( ecdsa_sig, nullptr ) ) );
+        auto out = der.data();
+        i2d_ECDSA_SIG( ecdsa_sig, &out );
+
+        const auto context = EVP_MD_CTX_new();
+        EVP_DigestVerifyInit( context, nullptr, EVP_sha256(), nullptr, pkey );
+        EVP_DigestVerifyUpdate( context, message.data(), message.size() );
+        const auto verified = EVP_DigestVerifyFinal( context, der.data(), der.size() ) == 1;
+
+        EVP_MD_CTX_free( context );
+        ECDSA_SIG_free( ecdsa_sig );
+        EVP_PKEY_free( pkey );
+
+        return verified;
+    }
+
+    /// <summary>
+    /// Runs a verification on a number of threads for the given time, and returns the verifications per second.
+    /// </summary>
+    template< typename Verify >
+    double measure( const unsigned threads, const std::chrono::duration< double > duration, Verify&& verify )
+    {
+        std::atomic< bool > stop = false;
+        std::atomic< std::uint64_t > total = 0, failed = 0;
+
+        std::vector< std::thread > workers;
+        const auto start = std::chrono::steady_clock::now();
+
+        for ( unsigned t = 0; t < threads; ++t )
+        {
+            workers.emplace_back( [ & ]
+            {
+                std::uint64_t count = 0, failures = 0;
+
+                for ( std::size_t i = 0; !stop.load( std::memory_order_relaxed ); ++i, ++count )
+                {
+                    if ( !verify( i ) )
+                        ++failures;
+                }
+
+                total += count;
+                failed += failures;
+            } );
+        }
+
+        std::this_thread::sleep_for( duration );
+        stop = true;
+
+        for ( auto& worker : workers )
+            worker.join();
+
+        if ( failed )
+            std::fprintf( stderr, "%llu verifications failed\n", static_cast< unsigned long long >( failed.load() ) );
+
+        return static_cast< double >( total ) / std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    }
+}  // namespace
+
+int main( int argc, char** argv )
+{
+    const std::chrono::duration< double > duration( argc > 1 ? std::strtod( argv[ 1 ], nullptr ) : 1.0 );
+
+    // About the size of a signed heartbeat response.
+    const std::string message =
+        R"({"data":{"hwid":"6d5f1b0a-3c1e-4f7a-9b2d-8e4c7a1f0b3d","timestamp":1760000000},"session":"0c5b3f2e-9a4d-4e1b-8f7c-2d6a1e9b3c5f"})";
+
+    std::vector< signer_t > signers;
+    std::vector< tsar::crypto::key > keys;
+
+    for ( int i = 0; i < 64; ++i )
+    {
+        signers.push_back( make_signer( message ) );
+
+        auto key = tsar::crypto::key::parse( signers.back().public_key );
+
+        if ( !key || signers.back().signature.size() != 64 )
+        {
+            std::fprintf( stderr, "Failed to generate the keys.\n" );
+            return 1;
+        }
+
+        keys.push_back( std::move( *key ) );
+    }
+
+    std::printf( "%-6s %-8s %14s %14s %8s\n", "keys", "threads", "before/s", "after/s", "speedup" );
+
+    for ( const unsigned threads : { 1u, 4u } )
+    {
+        for ( const std::size_t count : { 1u, 8u, 64u } )
+        {
+            const auto before = measure( threads, duration, [ & ]( std::size_t i )
+            {
+                const auto& signer = signers[ i % count ];
+                return verify_before( signer.public_key, message, signer.signature );
+            } );
+
+            const auto after = measure( threads, duration, [ & ]( std::size_t i )
+            {
+                const auto index = i % count;
+                return keys[ index ].verify( message, signers[ index ].signature );
+            } );
+
+            std::printf( "%-6zu %-8u %14.0f %14.0f %7.2fx\n", count, threads, before, after, after / before );
+        }
+    }
+
+    return 0;
+}
@@ -5,15 +5,42 @@
 #include <array>
 #include <cassert>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <expected>
+#include <optional>
 #include <stdexcept>
+#include <span>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <version>  // For __cpp_lib_bit_cast.
 
 #if defined( __cpp_lib_bit_cast )
 #include <bit>  // For std::bit_cast.
 #endif
 
+// The vectorized kernels are selected at runtime on x86. Define BASE64_NO_SIMD to only use the scalar tables. The NEON kernels of 64-bit ARM
+// have not been tested on hardware yet, so they are only used if BASE64_ENABLE_NEON is defined.
+#if !defined( BASE64_NO_SIMD )
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ ) || defined( _M_IX86 )
+#define BASE64_SIMD_X86
+#include <immintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+#elif ( defined( __aarch64__ ) || defined( _M_ARM64 ) ) && defined( BASE64_ENABLE_NEON )
+#define BASE64_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined( __GNUC__ ) || defined( __clang__ )
+#define BASE64_TARGET( features ) __attribute__( ( target( features ) ) )
+#else
+#define BASE64_TARGET( features )
+#endif
+
 namespace base64
 {
 
@@ -321,6 +348,358 @@ namespace base64
             'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/'
         };
 
+        /// <summary>
+        /// Vectorized kernels for the bulk of the data, after the shuffle-based algorithms of Muła and Lemire. A kernel only handles whole
+        /// blocks and returns how much of its input it consumed, and the scalar loops finish the rest, including the padding. A decode
+        /// kernel validates every block in-register and stops in front of the first one with a character outside of the alphabet, so that
+        /// the scalar loop reports it exactly as before.
+        /// </summary>
+        namespace simd
+        {
+            /// <summary>
+            /// Encodes whole groups of 3 bytes. Returns the number of bytes consumed, a multiple of 3.
+            /// </summary>
+            using encode_t = size_t ( * )( const uint8_t* bytes, size_t size, char* encoded ) noexcept;
+
+            /// <summary>
+            /// Decodes whole groups of 4 characters without padding. Returns the number of characters consumed, a multiple of 4. The output
+            /// may start at the same address as the text, because every block is read before its bytes are written.
+            /// </summary>
+            using decode_t = size_t ( * )( const uint8_t* text, size_t size, char* decoded ) noexcept;
+
+            inline size_t encode_scalar( const uint8_t*, size_t, char* ) noexcept
+            {
+                return 0;
+            }
+
+            inline size_t decode_scalar( const uint8_t*, size_t, char* ) noexcept
+            {
+                return 0;
+            }
+
+#if defined( BASE64_SIMD_X86 )
+
+            /// <summary>
+            /// Spreads 12 bytes over 16 lanes, with the 6-bit index of each character in the low bits of its lane.
+            /// </summary>
+            BASE64_TARGET( "sse4.1" ) inline __m128i encode_reshuffle( const __m128i in ) noexcept
+            {
+                const __m128i spread = _mm_shuffle_epi8( in, _mm_setr_epi8( 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 ) );
+                const __m128i even = _mm_mulhi_epu16( _mm_and_si128( spread, _mm_set1_epi32( 0x0FC0FC00 ) ), _mm_set1_epi32( 0x04000040 ) );
+                const __m128i odd = _mm_mullo_epi16( _mm_and_si128( spread, _mm_set1_epi32( 0x003F03F0 ) ), _mm_set1_epi32( 0x01000010 ) );
+                return _mm_or_si128( even, odd );
+            }
+
+            /// <summary>
+            /// Maps 6-bit indices to the characters of the alphabet by adding the offset of their range.
+            /// </summary>
+            BASE64_TARGET( "sse4.1" ) inline __m128i encode_translate( const __m128i indices ) noexcept
+            {
+                const __m128i offsets = _mm_setr_epi8( 65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0 );
+                __m128i range = _mm_subs_epu8( indices, _mm_set1_epi8( 51 ) );
+                range = _mm_sub_epi8( range, _mm_cmpgt_epi8( indices, _mm_set1_epi8( 25 ) ) );
+                return _mm_add_epi8( indices, _mm_shuffle_epi8( offsets, range ) );
+            }
+
+            /// <summary>
+            /// Maps characters to their 6-bit indices. Returns false if any of them is not in the alphabet.
+            /// </summary>
+            BASE64_TARGET( "sse4.1" ) inline bool decode_translate( __m128i& text ) noexcept
+            {
+                const __m128i lut_lo = _mm_setr_epi8( 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A );
+                const __m128i lut_hi = _mm_setr_epi8( 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+                const __m128i lut_roll = _mm_setr_epi8( 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 );
+                const __m128i nibble = _mm_set1_epi8( 0x0F );
+
+                const __m128i hi_nibbles = _mm_and_si128( _mm_srli_epi32( text, 4 ), nibble );
+                const __m128i lo = _mm_shuffle_epi8( lut_lo, _mm_and_si128( text, nibble ) );
+                const __m128i hi = _mm_shuffle_epi8( lut_hi, hi_nibbles );
+                if ( !_mm_testz_si128( lo, hi ) )
+                {
+                    return false;
+                }
+
+                // '/' shares its high nibble with '+', so it is moved to the slot of the unused high nibble 1.
+                const __m128i slash = _mm_cmpeq_epi8( text, _mm_set1_epi8( '/' ) );
+                text = _mm_add_epi8( text, _mm_shuffle_epi8( lut_roll, _mm_add_epi8( hi_nibbles, slash ) ) );
+                return true;
+            }
+
+            /// <summary>
+            /// Packs 16 6-bit indices into 12 bytes at the front of the register.
+            /// </summary>
+            BASE64_TARGET( "sse4.1" ) inline __m128i decode_reshuffle( const __m128i indices ) noexcept
+            {
+                const __m128i pairs = _mm_maddubs_epi16( indices, _mm_set1_epi32( 0x01400140 ) );
+                const __m128i quads = _mm_madd_epi16( pairs, _mm_set1_epi32( 0x00011000 ) );
+                return _mm_shuffle_epi8( quads, _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 ) );
+            }
+
+            BASE64_TARGET( "sse4.1" ) inline size_t encode_sse41( const uint8_t* bytes, const size_t size, char* encoded ) noexcept
+            {
+                size_t consumed = 0;
+
+                // Every load reads 16 bytes, of which 12 are encoded.
+                for ( ; size - consumed >= 16; consumed += 12, encoded += 16 )
+                {
+                    const __m128i in = _mm_loadu_si128( reinterpret_cast< const __m128i* >( bytes + consumed ) );
+                    _mm_storeu_si128( reinterpret_cast< __m128i* >( encoded ), encode_translate( encode_reshuffle( in ) ) );
+                }
+
+                return consumed;
+            }
+
+            BASE64_TARGET( "sse4.1" ) inline size_t decode_sse41( const uint8_t* text, const size_t size, char* decoded ) noexcept
+            {
+                size_t consumed = 0;
+
+                // Every store writes 16 bytes, of which 12 are decoded, so at least 2 more groups must follow to be overwritten later.
+                for ( ; size - consumed >= 24; consumed += 16, decoded += 12 )
+                {
+                    __m128i in = _mm_loadu_si128( reinterpret_cast< const __m128i* >( text + consumed ) );
+                    if ( !decode_translate( in ) )
+                    {
+                        break;
+                    }
+
+                    _mm_storeu_si128( reinterpret_cast< __m128i* >( decoded ), decode_reshuffle( in ) );
+                }
+
+                return consumed;
+            }
+
+            BASE64_TARGET( "avx2" ) inline __m256i encode_reshuffle( const __m256i in ) noexcept
+            {
+                const __m256i spread = _mm256_shuffle_epi8(
+                    in, _mm256_setr_epi8( 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 ) );
+                const __m256i even =
+                    _mm256_mulhi_epu16( _mm256_and_si256( spread, _mm256_set1_epi32( 0x0FC0FC00 ) ), _mm256_set1_epi32( 0x04000040 ) );
+                const __m256i odd =
+                    _mm256_mullo_epi16( _mm256_and_si256( spread, _mm256_set1_epi32( 0x003F03F0 ) ), _mm256_set1_epi32( 0x01000010 ) );
+                return _mm256_or_si256( even, odd );
+            }
+
+            BASE64_TARGET( "avx2" ) inline __m256i encode_translate( const __m256i indices ) noexcept
+            {
+                const __m256i offsets = _mm256_setr_epi8(
+                    65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0, 65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0 );
+                __m256i range = _mm256_subs_epu8( indices, _mm256_set1_epi8( 51 ) );
+                range = _mm256_sub_epi8( range, _mm256_cmpgt_epi8( indices, _mm256_set1_epi8( 25 ) ) );
+                return _mm256_add_epi8( indices, _mm256_shuffle_epi8( offsets, range ) );
+            }
+
+            BASE64_TARGET( "avx2" ) inline bool decode_translate( __m256i& text ) noexcept
+            {
+                const __m256i lut_lo = _mm256_setr_epi8(
+                    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A, 0x15, 0x11, 0x11, 0x11, 0x11,
+                    0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A );
+                const __m256i lut_hi = _mm256_setr_epi8(
+                    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x01, 0x02, 0x04,
+                    0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+                const __m256i lut_roll =
+                    _mm256_setr_epi8( 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 );
+                const __m256i nibble = _mm256_set1_epi8( 0x0F );
+
+                const __m256i hi_nibbles = _mm256_and_si256( _mm256_srli_epi32( text, 4 ), nibble );
+                const __m256i lo = _mm256_shuffle_epi8( lut_lo, _mm256_and_si256( text, nibble ) );
+                const __m256i hi = _mm256_shuffle_epi8( lut_hi, hi_nibbles );
+                if ( !_mm256_testz_si256( lo, hi ) )
+                {
+                    return false;
+                }
+
+                const __m256i slash = _mm256_cmpeq_epi8( text, _mm256_set1_epi8( '/' ) );
+                text = _mm256_add_epi8( text, _mm256_shuffle_epi8( lut_roll, _mm256_add_epi8( hi_nibbles, slash ) ) );
+                return true;
+            }
+
+            /// <summary>
+            /// Packs 32 6-bit indices into 24 bytes at the front of the register.
+            /// </summary>
+            BASE64_TARGET( "avx2" ) inline __m256i decode_reshuffle( const __m256i indices ) noexcept
+            {
+                const __m256i pairs = _mm256_maddubs_epi16( indices, _mm256_set1_epi32( 0x01400140 ) );
+                const __m256i quads = _mm256_madd_epi16( pairs, _mm256_set1_epi32( 0x00011000 ) );
+                const __m256i lanes = _mm256_shuffle_epi8(
+                    quads, _mm256_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 ) );
+                return _mm256_permutevar8x32_epi32( lanes, _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 3, 7 ) );
+            }
+
+            BASE64_TARGET( "avx2" ) inline size_t encode_avx2( const uint8_t* bytes, const size_t size, char* encoded ) noexcept
+            {
+                size_t consumed = 0;
+
+                // Each lane is loaded with 16 bytes, of which 12 are encoded, so the second load reads 4 bytes past the block.
+                for ( ; size - consumed >= 28; consumed += 24, encoded += 32 )
+                {
+                    const __m128i lo = _mm_loadu_si128( reinterpret_cast< const __m128i* >( bytes + consumed ) );
+                    const __m128i hi = _mm_loadu_si128( reinterpret_cast< const __m128i* >( bytes + consumed + 12 ) );
+                    const __m256i in = _mm256_inserti128_si256( _mm256_castsi128_si256( lo ), hi, 1 );
+                    _mm256_storeu_si256( reinterpret_cast< __m256i* >( encoded ), encode_translate( encode_reshuffle( in ) ) );
+                }
+
+                return consumed + encode_sse41( bytes + consumed, size - consumed, encoded );
+            }
+
+            BASE64_TARGET( "avx2" ) inline size_t decode_avx2( const uint8_t* text, const size_t size, char* decoded ) noexcept
+            {
+                size_t consumed = 0;
+
+                // Every store writes 32 bytes, of which 24 are decoded, so at least 3 more groups must follow to be overwritten later.
+                for ( ; size - consumed >= 44; consumed += 32, decoded += 24 )
+                {
+                    __m256i in = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( text + consumed ) );
+                    if ( !decode_translate( in ) )
+                    {
+                        return consumed;
+                    }
+
+                    _mm256_storeu_si256( reinterpret_cast< __m256i* >( decoded ), decode_reshuffle( in ) );
+                }
+
+                return consumed + decode_sse41( text + consumed, size - consumed, decoded );
+            }
+
+            /// <summary>
+            /// Gets the kernels the CPU supports. AVX2 also needs the operating system to save the upper halves of the registers.
+            /// </summary>
+            inline std::pair< encode_t, decode_t > select() noexcept
+            {
+#if defined( _MSC_VER )
+                int info[ 4 ];
+                __cpuid( info, 0 );
+                const int leaves = info[ 0 ];
+
+                __cpuid( info, 1 );
+                const bool sse41 = ( info[ 2 ] & ( 1 << 19 ) ) != 0;
+                const bool avx = ( info[ 2 ] & ( 1 << 27 ) ) != 0 && ( info[ 2 ] & ( 1 << 28 ) ) != 0 && ( _xgetbv( 0 ) & 6 ) == 6;
+
+                bool avx2 = false;
+                if ( avx && leaves >= 7 )
+                {
+                    __cpuidex( info, 7, 0 );
+                    avx2 = ( info[ 1 ] & ( 1 << 5 ) ) != 0;
+                }
+#else
+                __builtin_cpu_init();
+                const bool sse41 = __builtin_cpu_supports( "sse4.1" );
+                const bool avx2 = __builtin_cpu_supports( "avx2" );
+#endif
+
+                if ( avx2 )
+                {
+                    return { encode_avx2, decode_avx2 };
+                }
+
+                if ( sse41 )
+                {
+                    return { encode_sse41, decode_sse41 };
+                }
+
+                return { encode_scalar, decode_scalar };
+            }
+
+#elif defined( BASE64_SIMD_NEON )
+
+            inline size_t encode_neon( const uint8_t* bytes, const size_t size, char* encoded ) noexcept
+            {
+                const uint8_t* alphabet_data = reinterpret_cast< const uint8_t* >( encode_table_1.data() );
+                const uint8x16x4_t alphabet = {
+                    { vld1q_u8( alphabet_data ), vld1q_u8( alphabet_data + 16 ), vld1q_u8( alphabet_data + 32 ), vld1q_u8( alphabet_data + 48 ) } };
+                const uint8x16_t mask = vdupq_n_u8( 0x3F );
+
+                size_t consumed = 0;
+
+                // The loads and stores de-interleave the groups, so every byte of the block is in the same lane of its register.
+                for ( ; size - consumed >= 48; consumed += 48, encoded += 64 )
+                {
+                    const uint8x16x3_t in = vld3q_u8( bytes + consumed );
+
+                    uint8x16x4_t out;
+                    out.val[ 0 ] = vshrq_n_u8( in.val[ 0 ], 2 );
+                    out.val[ 1 ] = vandq_u8( vorrq_u8( vshlq_n_u8( in.val[ 0 ], 4 ), vshrq_n_u8( in.val[ 1 ], 4 ) ), mask );
+                    out.val[ 2 ] = vandq_u8( vorrq_u8( vshlq_n_u8( in.val[ 1 ], 2 ), vshrq_n_u8( in.val[ 2 ], 6 ) ), mask );
+                    out.val[ 3 ] = vandq_u8( in.val[ 2 ], mask );
+
+                    for ( auto& indices : out.val )
+                    {
+                        indices = vqtbl4q_u8( alphabet, indices );
+                    }
+
+                    vst4q_u8( reinterpret_cast< uint8_t* >( encoded ), out );
+                }
+
+                return consumed;
+            }
+
+            inline size_t decode_neon( const uint8_t* text, const size_t size, char* decoded ) noexcept
+            {
+                const uint8x16_t lut_lo = { 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A };
+                const uint8x16_t lut_hi = { 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 };
+                const uint8x16_t lut_roll = { 0, 16, 19, 4, 191, 191, 185, 185, 0, 0, 0, 0, 0, 0, 0, 0 };
+                const uint8x16_t nibble = vdupq_n_u8( 0x0F );
+                const uint8x16_t slash = vdupq_n_u8( '/' );
+
+                size_t consumed = 0;
+
+                for ( ; size - consumed >= 64; consumed += 64, decoded += 48 )
+                {
+                    uint8x16x4_t in = vld4q_u8( text + consumed );
+
+                    uint8x16_t invalid = vdupq_n_u8( 0 );
+                    for ( auto& characters : in.val )
+                    {
+                        const uint8x16_t hi_nibbles = vshrq_n_u8( characters, 4 );
+                        const uint8x16_t lo = vqtbl1q_u8( lut_lo, vandq_u8( characters, nibble ) );
+                        const uint8x16_t hi = vqtbl1q_u8( lut_hi, hi_nibbles );
+                        invalid = vorrq_u8( invalid, vandq_u8( lo, hi ) );
+
+                        const uint8x16_t roll = vqtbl1q_u8( lut_roll, vaddq_u8( hi_nibbles, vceqq_u8( characters, slash ) ) );
+                        characters = vaddq_u8( characters, roll );
+                    }
+
+                    if ( vmaxvq_u8( invalid ) != 0 )
+                    {
+                        break;
+                    }
+
+                    uint8x16x3_t out;
+                    out.val[ 0 ] = vorrq_u8( vshlq_n_u8( in.val[ 0 ], 2 ), vshrq_n_u8( in.val[ 1 ], 4 ) );
+                    out.val[ 1 ] = vorrq_u8( vshlq_n_u8( in.val[ 1 ], 4 ), vshrq_n_u8( in.val[ 2 ], 2 ) );
+                    out.val[ 2 ] = vorrq_u8( vshlq_n_u8( in.val[ 2 ], 6 ), in.val[ 3 ] );
+                    vst3q_u8( reinterpret_cast< uint8_t* >( decoded ), out );
+                }
+
+                return consumed;
+            }
+
+            /// <summary>
+            /// Gets the kernels the CPU supports. NEON is part of every 64-bit ARM CPU.
+            /// </summary>
+            inline std::pair< encode_t, decode_t > select() noexcept
+            {
+                return { encode_neon, decode_neon };
+            }
+
+#else
+
+            inline std::pair< encode_t, decode_t > select() noexcept
+            {
+                return { encode_scalar, decode_scalar };
+            }
+
+#endif
+
+            /// <summary>
+            /// The kernels of the CPU this runs on, selected on first use.
+            /// </summary>
+            inline const std::pair< encode_t, decode_t >& kernels() noexcept
+            {
+                static const std::pair< encode_t, decode_t > selected = select();
+                return selected;
+            }
+        }  // namespace simd
+
     }  // namespace detail
 
     template< class OutputBuffer, class InputIterator >
@@ -341,7 +720,11 @@ namespace base64
         const uint8_t* bytes = reinterpret_cast< const uint8_t* >( &*begin );
         char* currEncoding = reinterpret_cast< char* >( &encoded[ 0 ] );
 
-        for ( size_t i = binarytextsize / 3; i; --i )
+        const size_t vectorized = detail::simd::kernels().first( bytes, binarytextsize, currEncoding );
+        bytes += vectorized;
+        currEncoding += vectorized / 3 * 4;
+
+        for ( size_t i = ( binarytextsize - vectorized ) / 3; i; --i )
         {
             const uint8_t t1 = *bytes++;
             const uint8_t t2 = *bytes++;
@@ -379,7 +762,8 @@ namespace base64
             }
             default:
             {
-                throw std::runtime_error{ "Invalid base64 encoded data" };
+                // The remainder of a division by 3 is always one of the cases above.
+                break;
             }
         }
 
@@ -397,120 +781,371 @@ namespace base64
         return encode_into< std::string >( std::begin( data ), std::end( data ) );
     }
 
-    template< class OutputBuffer >
-    inline OutputBuffer decode_into( std::string_view base64Text )
+    /// <summary>
+    /// The reasons base64 text fails to decode.
+    /// </summary>
+    enum class error_code_t : uint8_t
     {
-        typedef typename OutputBuffer::value_type output_value_type;
-        static_assert(
-            std::is_same_v< output_value_type, char > || std::is_same_v< output_value_type, signed char > ||
-            std::is_same_v< output_value_type, unsigned char > || std::is_same_v< output_value_type, std::byte > );
-        if ( base64Text.empty() )
+        /// <summary>
+        /// The size of the text is not a multiple of 4.
+        /// </summary>
+        invalid_length_t,
+
+        /// <summary>
+        /// The text ends in more than 2 padding signs.
+        /// </summary>
+        invalid_padding_t,
+
+        /// <summary>
+        /// The text contains a character outside of the alphabet, or a padding sign before its end.
+        /// </summary>
+        invalid_character_t,
+
+        /// <summary>
+        /// The output buffer is too small for the decoded data.
+        /// </summary>
+        output_too_small_t
+    };
+
+    /// <summary>
+    /// Why and where base64 text failed to decode.
+    /// </summary>
+    struct base64_error
+    {
+        error_code_t code;
+
+        /// <summary>
+        /// The offset of the first invalid character in the text. Zero for the other errors.
+        /// </summary>
+        size_t offset = 0;
+
+        const char* what() const noexcept
         {
-            return OutputBuffer();
+            switch ( code )
+            {
+                case error_code_t::invalid_length_t: return "Invalid base64 encoded data - Size not divisible by 4";
+                case error_code_t::invalid_padding_t: return "Invalid base64 encoded data - Found more than 2 padding signs";
+                case error_code_t::invalid_character_t: return "Invalid base64 encoded data - Invalid character";
+                case error_code_t::output_too_small_t: return "Invalid output buffer - Too small for the decoded data";
+            }
+
+            return "Invalid base64 encoded data";
         }
+    };
 
-        if ( ( base64Text.size() & 3 ) != 0 )
+    namespace detail
+    {
+        /// <summary>
+        /// Throws a decoding error for the throwing API, or aborts if exceptions are disabled.
+        /// </summary>
+        [[noreturn]] inline void raise( const base64_error& error )
         {
-            throw std::runtime_error{ "Invalid base64 encoded data - Size not divisible by 4" };
+#if defined( __cpp_exceptions ) || defined( _CPPUNWIND )
+            throw std::runtime_error{ error.what() };
+#else
+            ( void )error;
+            std::abort();
+#endif
         }
 
-        const size_t numPadding = std::count( base64Text.rbegin(), base64Text.rbegin() + 4, '=' );
-        if ( numPadding > 2 )
+        /// <summary>
+        /// Validates the size and the padding of base64 text, and gets the size of the data it decodes to.
+        /// </summary>
+        constexpr std::expected< size_t, base64_error > decoded_size( std::string_view base64Text ) noexcept
         {
-            throw std::runtime_error{ "Invalid base64 encoded data - Found more than 2 padding signs" };
-        }
+            if ( ( base64Text.size() & 3 ) != 0 )
+            {
+                return std::unexpected( base64_error{ error_code_t::invalid_length_t } );
+            }
 
-        const size_t decodedsize = ( base64Text.size() * 3 >> 2 ) - numPadding;
-        OutputBuffer decoded( decodedsize, '.' );
+            const size_t numPadding = base64Text.empty() ? 0 : std::count( base64Text.rbegin(), base64Text.rbegin() + 4, '=' );
+            if ( numPadding > 2 )
+            {
+                return std::unexpected( base64_error{ error_code_t::invalid_padding_t } );
+            }
 
-        const uint8_t* bytes = reinterpret_cast< const uint8_t* >( &base64Text[ 0 ] );
-        char* currDecoding = reinterpret_cast< char* >( &decoded[ 0 ] );
+            return ( base64Text.size() * 3 >> 2 ) - numPadding;
+        }
 
-        for ( size_t i = ( base64Text.size() >> 2 ) - ( numPadding != 0 ); i; --i )
+        /// <summary>
+        /// Gets the error for a group of characters that failed to decode, with the offset of its first invalid character.
+        /// </summary>
+        constexpr std::unexpected< base64_error > invalid_character( std::string_view base64Text, size_t offset ) noexcept
         {
-            const uint8_t t1 = *bytes++;
-            const uint8_t t2 = *bytes++;
-            const uint8_t t3 = *bytes++;
-            const uint8_t t4 = *bytes++;
-
-            const uint32_t d1 = detail::decode_table_0[ t1 ];
-            const uint32_t d2 = detail::decode_table_1[ t2 ];
-            const uint32_t d3 = detail::decode_table_2[ t3 ];
-            const uint32_t d4 = detail::decode_table_3[ t4 ];
+            while ( offset < base64Text.size() && detail::decode_table_0[ static_cast< uint8_t >( base64Text[ offset ] ) ] != detail::bad_char )
+            {
+                ++offset;
+            }
 
-            const uint32_t temp = d1 | d2 | d3 | d4;
+            return std::unexpected( base64_error{ error_code_t::invalid_character_t, offset } );
+        }
 
-            if ( temp >= detail::bad_char )
+        /// <summary>
+        /// Decodes base64 text of a validated size. The output may start at the same address as the text, because every group of 4
+        /// characters is read before its 3 bytes are written.
+        /// </summary>
+        /// <returns>The decoded size, or the first invalid character.</returns>
+        constexpr std::expected< size_t, base64_error > decode_raw( std::string_view base64Text, const size_t decodedsize, char* currDecoding ) noexcept
+        {
+            if ( base64Text.empty() )
             {
-                throw std::runtime_error{ "Invalid base64 encoded data - Invalid character" };
+                return 0;
             }
 
-            // Use bit_cast instead of union and type punning to avoid
-            // undefined behaviour risk:
-            // https://en.wikipedia.org/wiki/Type_punning#Use_of_union
-            const std::array< char, 4 > tempBytes = detail::bit_cast< std::array< char, 4 >, uint32_t >( temp );
+            const size_t numPadding = base64Text.size() * 3 / 4 - decodedsize;
 
-            *currDecoding++ = tempBytes[ detail::decidx0 ];
-            *currDecoding++ = tempBytes[ detail::decidx1 ];
-            *currDecoding++ = tempBytes[ detail::decidx2 ];
-        }
+            const size_t groups = ( base64Text.size() >> 2 ) - ( numPadding != 0 );
 
-        switch ( numPadding )
-        {
-            case 0:
+            // The kernels are only used at runtime, constant evaluation goes through the tables alone.
+            size_t offset = 0;
+            if !consteval
             {
-                break;
+                offset = detail::simd::kernels().second( reinterpret_cast< const uint8_t* >( base64Text.data() ), groups << 2, currDecoding );
+                currDecoding += offset / 4 * 3;
             }
-            case 1:
+
+            for ( size_t i = groups - offset / 4; i; --i )
             {
-                const uint8_t t1 = *bytes++;
-                const uint8_t t2 = *bytes++;
-                const uint8_t t3 = *bytes++;
+                const uint8_t t1 = base64Text[ offset++ ];
+                const uint8_t t2 = base64Text[ offset++ ];
+                const uint8_t t3 = base64Text[ offset++ ];
+                const uint8_t t4 = base64Text[ offset++ ];
 
                 const uint32_t d1 = detail::decode_table_0[ t1 ];
                 const uint32_t d2 = detail::decode_table_1[ t2 ];
                 const uint32_t d3 = detail::decode_table_2[ t3 ];
+                const uint32_t d4 = detail::decode_table_3[ t4 ];
 
-                const uint32_t temp = d1 | d2 | d3;
+                const uint32_t temp = d1 | d2 | d3 | d4;
 
                 if ( temp >= detail::bad_char )
                 {
-                    throw std::runtime_error{ "Invalid base64 encoded data - Invalid character" };
+                    return invalid_character( base64Text, offset - 4 );
                 }
 
                 // Use bit_cast instead of union and type punning to avoid
                 // undefined behaviour risk:
                 // https://en.wikipedia.org/wiki/Type_punning#Use_of_union
                 const std::array< char, 4 > tempBytes = detail::bit_cast< std::array< char, 4 >, uint32_t >( temp );
+
                 *currDecoding++ = tempBytes[ detail::decidx0 ];
                 *currDecoding++ = tempBytes[ detail::decidx1 ];
-                break;
+                *currDecoding++ = tempBytes[ detail::decidx2 ];
             }
-            case 2:
+
+            switch ( numPadding )
             {
-                const uint8_t t1 = *bytes++;
-                const uint8_t t2 = *bytes++;
+                case 0:
+                {
+                    break;
+                }
+                case 1:
+                {
+                    const uint8_t t1 = base64Text[ offset++ ];
+                    const uint8_t t2 = base64Text[ offset++ ];
+                    const uint8_t t3 = base64Text[ offset++ ];
 
-                const uint32_t d1 = detail::decode_table_0[ t1 ];
-                const uint32_t d2 = detail::decode_table_1[ t2 ];
+                    const uint32_t d1 = detail::decode_table_0[ t1 ];
+                    const uint32_t d2 = detail::decode_table_1[ t2 ];
+                    const uint32_t d3 = detail::decode_table_2[ t3 ];
 
-                const uint32_t temp = d1 | d2;
+                    const uint32_t temp = d1 | d2 | d3;
 
-                if ( temp >= detail::bad_char )
-                {
-                    throw std::runtime_error{ "Invalid base64 encoded data - Invalid character" };
+                    if ( temp >= detail::bad_char )
+                    {
+                        return invalid_character( base64Text, offset - 3 );
+                    }
+
+                    // Use bit_cast instead of union and type punning to avoid
+                    // undefined behaviour risk:
+                    // https://en.wikipedia.org/wiki/Type_punning#Use_of_union
+                    const std::array< char, 4 > tempBytes = detail::bit_cast< std::array< char, 4 >, uint32_t >( temp );
+                    *currDecoding++ = tempBytes[ detail::decidx0 ];
+                    *currDecoding++ = tempBytes[ detail::decidx1 ];
+                    break;
                 }
+                case 2:
+                {
+                    const uint8_t t1 = base64Text[ offset++ ];
+                    const uint8_t t2 = base64Text[ offset++ ];
 
-                const std::array< char, 4 > tempBytes = detail::bit_cast< std::array< char, 4 >, uint32_t >( temp );
-                *currDecoding++ = tempBytes[ detail::decidx0 ];
-                break;
-            }
-            default:
-            {
-                throw std::runtime_error{ "Invalid base64 encoded data - Invalid padding number" };
+                    const uint32_t d1 = detail::decode_table_0[ t1 ];
+                    const uint32_t d2 = detail::decode_table_1[ t2 ];
+
+                    const uint32_t temp = d1 | d2;
+
+                    if ( temp >= detail::bad_char )
+                    {
+                        return invalid_character( base64Text, offset - 2 );
+                    }
+
+                    const std::array< char, 4 > tempBytes = detail::bit_cast< std::array< char, 4 >, uint32_t >( temp );
+                    *currDecoding++ = tempBytes[ detail::decidx0 ];
+                    break;
+                }
+                default:
+                {
+                    return std::unexpected( base64_error{ error_code_t::invalid_padding_t } );
+                }
             }
+
+            return decodedsize;
+        }
+    }  // namespace detail
+
+    /// <summary>
+    /// Decodes into an existing buffer, so that a buffer reused across calls keeps its capacity. Only the allocation of the buffer can
+    /// throw.
+    /// </summary>
+    /// <returns>The number of bytes decoded, or why the text is not valid base64.</returns>
+    template< class OutputBuffer >
+    inline std::expected< size_t, base64_error > try_decode_to( std::string_view base64Text, OutputBuffer& decoded )
+    {
+        typedef typename OutputBuffer::value_type output_value_type;
+        static_assert(
+            std::is_same_v< output_value_type, char > || std::is_same_v< output_value_type, signed char > ||
+            std::is_same_v< output_value_type, unsigned char > || std::is_same_v< output_value_type, std::byte > );
+        const auto decodedsize = detail::decoded_size( base64Text );
+        if ( !decodedsize )
+        {
+            return std::unexpected( decodedsize.error() );
+        }
+
+        decoded.resize( *decodedsize );
+        if ( decoded.empty() )
+        {
+            return 0;
+        }
+
+        return detail::decode_raw( base64Text, *decodedsize, reinterpret_cast< char* >( &decoded[ 0 ] ) );
+    }
+
+    /// <summary>
+    /// Decodes into a caller-supplied buffer, e.g. on the stack or, in a constant expression, into an array embedded in the binary.
+    /// </summary>
+    /// <returns>The number of bytes written, or why the text is not valid base64 or does not fit.</returns>
+    constexpr std::expected< size_t, base64_error > try_decode_into( std::string_view base64Text, std::span< char > decoded ) noexcept
+    {
+        const auto decodedsize = detail::decoded_size( base64Text );
+        if ( !decodedsize )
+        {
+            return std::unexpected( decodedsize.error() );
+        }
+
+        if ( *decodedsize > decoded.size() )
+        {
+            return std::unexpected( base64_error{ error_code_t::output_too_small_t } );
+        }
+
+        return detail::decode_raw( base64Text, *decodedsize, decoded.data() );
+    }
+
+    /// <summary>
+    /// Decodes into a caller-supplied buffer, e.g. on the stack.
+    /// </summary>
+    /// <returns>The number of bytes written, or why the text is not valid base64 or does not fit.</returns>
+    inline std::expected< size_t, base64_error > try_decode_into( std::string_view base64Text, std::span< std::byte > decoded ) noexcept
+    {
+        return try_decode_into( base64Text, std::span< char >( reinterpret_cast< char* >( decoded.data() ), decoded.size() ) );
+    }
+
+    /// <summary>
+    /// Decodes the base64 text in a buffer into the same buffer. The decoded data is always shorter than the text. On failure the contents
+    /// of the buffer are unspecified.
+    /// </summary>
+    /// <returns>The number of bytes written to the front of the buffer, or why the text is not valid base64.</returns>
+    inline std::expected< size_t, base64_error > try_decode_in_place( std::span< char > buffer ) noexcept
+    {
+        const std::string_view base64Text( buffer.data(), buffer.size() );
+        const auto decodedsize = detail::decoded_size( base64Text );
+        if ( !decodedsize )
+        {
+            return std::unexpected( decodedsize.error() );
+        }
+
+        return detail::decode_raw( base64Text, *decodedsize, buffer.data() );
+    }
+
+    /// <summary>
+    /// Decodes the base64 text in a resizable buffer into the same buffer, and shrinks it to the decoded data without releasing its memory.
+    /// </summary>
+    template< class Buffer >
+        requires requires( Buffer& buffer ) { buffer.resize( buffer.size() ); }
+    inline std::expected< size_t, base64_error > try_decode_in_place( Buffer& buffer ) noexcept
+    {
+        typedef typename Buffer::value_type value_type;
+        static_assert(
+            std::is_same_v< value_type, char > || std::is_same_v< value_type, signed char > ||
+            std::is_same_v< value_type, unsigned char > || std::is_same_v< value_type, std::byte > );
+        const auto decodedsize = try_decode_in_place( std::span< char >( reinterpret_cast< char* >( buffer.data() ), buffer.size() ) );
+        if ( decodedsize )
+        {
+            buffer.resize( *decodedsize );
+        }
+
+        return decodedsize;
+    }
+
+    /// <summary>
+    /// Decodes into an existing buffer, so that a buffer reused across calls keeps its capacity.
+    /// </summary>
+    template< class OutputBuffer >
+    inline void decode_to( std::string_view base64Text, OutputBuffer& decoded )
+    {
+        if ( const auto result = try_decode_to( base64Text, decoded ); !result )
+        {
+            detail::raise( result.error() );
+        }
+    }
+
+    /// <summary>
+    /// Decodes into a caller-supplied buffer, e.g. on the stack.
+    /// </summary>
+    /// <returns>The number of bytes written.</returns>
+    inline size_t decode_into( std::string_view base64Text, std::span< std::byte > decoded )
+    {
+        const auto result = try_decode_into( base64Text, decoded );
+        if ( !result )
+        {
+            detail::raise( result.error() );
+        }
+
+        return *result;
+    }
+
+    /// <summary>
+    /// Decodes the base64 text in a buffer into the same buffer. The decoded data is always shorter than the text.
+    /// </summary>
+    /// <returns>The number of bytes written to the front of the buffer.</returns>
+    inline size_t decode_in_place( std::span< char > buffer )
+    {
+        const auto result = try_decode_in_place( buffer );
+        if ( !result )
+        {
+            detail::raise( result.error() );
         }
 
+        return *result;
+    }
+
+    /// <summary>
+    /// Decodes the base64 text in a resizable buffer into the same buffer, and shrinks it to the decoded data without releasing its memory.
+    /// </summary>
+    template< class Buffer >
+        requires requires( Buffer& buffer ) { buffer.resize( buffer.size() ); }
+    inline void decode_in_place( Buffer& buffer )
+    {
+        if ( const auto result = try_decode_in_place( buffer ); !result )
+        {
+            detail::raise( result.error() );
+        }
+    }
+
+    template< class OutputBuffer >
+    inline OutputBuffer decode_into( std::string_view base64Text )
+    {
+        OutputBuffer decoded;
+        decode_to( base64Text, decoded );
         return decoded;
     }
 
@@ -531,17 +1166,205 @@ namespace base64
     }
 
     inline std::optional< std::string > safe_from_base64( std::string_view data ) noexcept
-	{
-		try
-		{
-			return from_base64( data );
-		}
-		catch ( const std::exception& e )
-		{
-			return std::nullopt;
-		}
-	}
+    {
+        std::string decoded;
+        if ( !try_decode_to( data, decoded ) )
+        {
+            return std::nullopt;
+        }
+
+        return decoded;
+    }
+
+    /// <summary>
+    /// Decodes into an existing buffer without throwing. Returns false if the data is not valid base64.
+    /// </summary>
+    template< class OutputBuffer >
+    inline bool safe_from_base64( std::string_view data, OutputBuffer& output ) noexcept
+    {
+        return try_decode_to( data, output ).has_value();
+    }
+
+    /// <summary>
+    /// Decodes into a caller-supplied buffer without throwing. Returns nothing if the data is not valid base64 or the buffer is too small.
+    /// </summary>
+    inline std::optional< size_t > safe_decode_into( std::string_view data, std::span< std::byte > output ) noexcept
+    {
+        const auto result = try_decode_into( data, output );
+        return result ? std::optional< size_t >( *result ) : std::nullopt;
+    }
+
+    /// <summary>
+    /// Decodes a buffer in place without throwing. Returns false if the buffer does not hold valid base64, in which case its contents
+    /// are unspecified.
+    /// </summary>
+    template< class Buffer >
+    inline bool safe_decode_in_place( Buffer& buffer ) noexcept
+    {
+        return try_decode_in_place( buffer ).has_value();
+    }
+
+    /// <summary>
+    /// A resumable decoder for base64 text that arrives in chunks of any size, such as a response body as cURL hands it over. A group of 4
+    /// characters split across chunks is carried over, and the decoded bytes are passed to a sink in pieces of at most `window_size` bytes,
+    /// so the text never has to be buffered as a whole. Valid text is accepted exactly like a whole buffer. Invalid text fails at its
+    /// first error as it streams in, so an invalid character is reported before a size that is not a multiple of 4, and a group of more
+    /// than 2 padding signs may be reported as invalid padding or as an invalid character, depending on where the chunks are split.
+    /// </summary>
+    class decoder
+    {
+       public:
+        /// <summary>
+        /// The maximum number of bytes passed to the sink at once.
+        /// </summary>
+        static constexpr size_t window_size = 768;
+
+        /// <summary>
+        /// Decodes the next chunk of text and passes the decoded bytes to the sink as a std::string_view. The bytes passed before an error
+        /// are the decoded prefix of the text, so the result of `finish` decides whether they can be used.
+        /// </summary>
+        /// <returns>The first error in the text so far. Once an error is returned, every later call returns it as well.</returns>
+        template< class Sink >
+        std::expected< void, base64_error > feed( std::string_view chunk, Sink&& sink )
+        {
+            if ( failure )
+            {
+                return std::unexpected( *failure );
+            }
+
+            while ( !chunk.empty() )
+            {
+                // Only the last group of the text may be padded.
+                if ( padded )
+                {
+                    return fail( base64_error{ error_code_t::invalid_character_t, padding_offset } );
+                }
+
+                if ( pending_size > 0 || chunk.size() < 4 )
+                {
+                    const size_t count = std::min( pending.size() - pending_size, chunk.size() );
+                    std::memcpy( pending.data() + pending_size, chunk.data(), count );
+                    pending_size += count;
+                    chunk.remove_prefix( count );
+
+                    if ( pending_size < pending.size() )
+                    {
+                        break;
+                    }
+
+                    pending_size = 0;
+                    if ( const auto result = decode( std::string_view( pending.data(), pending.size() ), sink ); !result )
+                    {
+                        return result;
+                    }
+
+                    continue;
+                }
+
+                const std::string_view text = chunk.substr( 0, std::min( chunk.size() & ~size_t{ 3 }, window_size / 3 * 4 ) );
+                if ( const auto result = decode( text, sink ); !result )
+                {
+                    return result;
+                }
+
+                chunk.remove_prefix( text.size() );
+            }
+
+            return {};
+        }
+
+        /// <summary>
+        /// Validates the end of the text, which may not leave a partial group of 4 characters behind.
+        /// </summary>
+        std::expected< void, base64_error > finish() noexcept
+        {
+            if ( failure )
+            {
+                return std::unexpected( *failure );
+            }
+
+            if ( pending_size != 0 )
+            {
+                return fail( base64_error{ error_code_t::invalid_length_t } );
+            }
+
+            return {};
+        }
+
+        /// <summary>
+        /// Prepares the decoder for a new text.
+        /// </summary>
+        void reset() noexcept
+        {
+            pending_size = 0;
+            position = 0;
+            padded = false;
+            failure.reset();
+        }
+
+       private:
+        /// <summary>
+        /// Decodes whole groups of 4 characters into the window and passes them to the sink.
+        /// </summary>
+        template< class Sink >
+        std::expected< void, base64_error > decode( const std::string_view text, Sink& sink )
+        {
+            auto decodedsize = detail::decoded_size( text );
+            if ( decodedsize )
+            {
+                decodedsize = detail::decode_raw( text, *decodedsize, window.data() );
+            }
+
+            if ( !decodedsize )
+            {
+                auto error = decodedsize.error();
+                if ( error.code == error_code_t::invalid_character_t )
+                {
+                    error.offset += position;
+                }
+
+                return fail( error );
+            }
+
+            if ( *decodedsize < text.size() / 4 * 3 )
+            {
+                padded = true;
+                padding_offset = position + text.find( detail::padding_char, text.size() - 4 );
+            }
+
+            position += text.size();
+            sink( std::string_view( window.data(), *decodedsize ) );
+            return {};
+        }
+
+        std::unexpected< base64_error > fail( const base64_error& error ) noexcept
+        {
+            failure = error;
+            return std::unexpected( error );
+        }
+
+        std::array< char, window_size > window;
+
+        /// <summary>
+        /// The characters of a group that was split across chunks.
+        /// </summary>
+        std::array< char, 4 > pending;
+        size_t pending_size = 0;
+
+        /// <summary>
+        /// The offset of the next group in the text.
+        /// </summary>
+        size_t position = 0;
+
+        /// <summary>
+        /// Whether a padded group was decoded, and the offset of its first padding sign.
+        /// </summary>
+        bool padded = false;
+        size_t padding_offset = 0;
+
+        std::optional< base64_error > failure;
+    };
 
 }  // namespace base64
 
-#endif  // BASE64_HPP_
\ No newline at end of file
+#endif  // BASE64_HPP_
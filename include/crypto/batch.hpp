@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "key.hpp"
+
+namespace tsar::crypto
+{
+    /// <summary>
+    /// Verifies many signed responses at once across a pool of worker threads, instead of one after another on the thread that received
+    /// them. Each item is verified exactly like `key::verify`, so the result of an item does not depend on the batch it is in.
+    /// </summary>
+    class batch final
+    {
+       public:
+        /// <summary>
+        /// A signed message to verify.
+        /// </summary>
+        struct item_t
+        {
+            /// <summary>
+            /// The key that signed the message. Must not be null.
+            /// </summary>
+            const key* signer;
+
+            std::string_view message;
+
+            /// <summary>
+            /// The raw (r||s) ECDSA signature of the message.
+            /// </summary>
+            std::string_view signature;
+        };
+
+        /// <summary>
+        /// Gets the verifier shared by the whole process, with a worker for every hardware thread but the caller's. The workers are started
+        /// by the first batch that needs them.
+        /// </summary>
+        static batch& get() noexcept;
+
+        /// <param name="workers">The number of worker threads. The calling thread verifies items of its batches too.</param>
+        explicit batch( std::size_t workers ) noexcept;
+        ~batch();
+
+        batch( const batch& ) = delete;
+        batch& operator=( const batch& ) = delete;
+
+        /// <summary>
+        /// Verifies every item and blocks until all of them are done.
+        /// </summary>
+        /// <param name="items">The signed messages.</param>
+        /// <param name="results">Receives whether the signature of the item at the same index is valid. Must be as large as the items.</param>
+        void verify( std::span< const item_t > items, std::span< bool > results ) noexcept;
+
+        /// <summary>
+        /// Verifies every item and blocks until all of them are done.
+        /// </summary>
+        /// <returns>Whether the signature of the item at the same index is valid.</returns>
+        std::vector< bool > verify( std::span< const item_t > items );
+
+       private:
+        /// <summary>
+        /// A batch that is being verified. Workers and the caller claim items by their index until none are left.
+        /// </summary>
+        struct job_t
+        {
+            std::span< const item_t > items;
+            std::span< bool > results;
+
+            std::atomic< std::size_t > next, done;
+        };
+
+        /// <summary>
+        /// Verifies unclaimed items of a job until none are left.
+        /// </summary>
+        /// <returns>True if this call completed the last item of the job.</returns>
+        static bool drain( job_t& job ) noexcept;
+
+        /// <summary>
+        /// Starts the worker threads, unless they are already running. Must be called with the lock held.
+        /// </summary>
+        bool start() noexcept;
+
+        /// <summary>
+        /// The loop of a worker thread.
+        /// </summary>
+        void work() noexcept;
+
+        std::size_t worker_count;
+
+        std::mutex mutex;
+        std::condition_variable ready, finished;
+
+        std::deque< std::shared_ptr< job_t > > jobs;
+        bool stopping;
+
+        std::vector< std::thread > workers;
+    };
+}  // namespace tsar::crypto
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <string_view>
+
+namespace tsar::crypto::der
+{
+    /// <summary>
+    /// The size of a raw P-256 signature: r and s as 32-byte big-endian integers.
+    /// </summary>
+    constexpr std::size_t raw_signature_size = 64;
+
+    /// <summary>
+    /// The size of the largest DER encoding of a P-256 signature: a sequence of two integers of 33 bytes each.
+    /// </summary>
+    constexpr std::size_t max_signature_size = 72;
+
+    /// <summary>
+    /// The size of the DER encoding of a P-256 public key: a SubjectPublicKeyInfo with an uncompressed point.
+    /// </summary>
+    constexpr std::size_t public_key_size = 91;
+
+    /// <summary>
+    /// The part of a P-256 SubjectPublicKeyInfo in front of the coordinates of the point: the sequence headers, the id-ecPublicKey and
+    /// prime256v1 object identifiers, the header of the bit string and the marker of an uncompressed point.
+    /// </summary>
+    constexpr std::uint8_t public_key_prefix[] = { 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x02, 0x01, 0x06,
+                                                   0x08, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x03, 0x01, 0x07, 0x03, 0x42, 0x00, 0x04 };
+
+    /// <summary>
+    /// Checks that DER data is the encoding of a P-256 public key. Whether the point is on the curve is only checked when the key is parsed.
+    /// </summary>
+    constexpr bool is_public_key( const std::string_view der ) noexcept
+    {
+        if ( der.size() != public_key_size )
+            return false;
+
+        for ( std::size_t i = 0; i < std::size( public_key_prefix ); ++i )
+            if ( static_cast< std::uint8_t >( der[ i ] ) != public_key_prefix[ i ] )
+                return false;
+
+        return true;
+    }
+
+    /// <summary>
+    /// Encodes one half of a raw signature as a DER integer. Leading zeros are stripped, and a zero byte is prepended if the high bit of
+    /// the first remaining byte is set, so that the integer stays positive.
+    /// </summary>
+    constexpr std::size_t encode_integer( const std::string_view value, std::uint8_t* out ) noexcept
+    {
+        std::size_t start = 0;
+        while ( start + 1 < value.size() && value[ start ] == '\0' )
+            ++start;
+
+        const bool pad = static_cast< std::uint8_t >( value[ start ] ) & 0x80;
+        const auto length = value.size() - start + pad;
+
+        std::size_t size = 0;
+        out[ size++ ] = 0x02;
+        out[ size++ ] = static_cast< std::uint8_t >( length );
+
+        if ( pad )
+            out[ size++ ] = 0x00;
+
+        for ( auto i = start; i < value.size(); ++i )
+            out[ size++ ] = static_cast< std::uint8_t >( value[ i ] );
+
+        return size;
+    }
+
+    /// <summary>
+    /// Encodes a raw (r||s) P-256 signature as a DER ECDSA-Sig-Value, the format OpenSSL verifies. The encoding is written straight from
+    /// the raw bytes, without any intermediate big numbers.
+    /// </summary>
+    /// <param name="raw">The raw signature.</param>
+    /// <param name="out">Receives the encoding.</param>
+    /// <returns>The size of the encoding, or 0 if the raw signature is not 64 bytes.</returns>
+    constexpr std::size_t encode_signature( const std::string_view raw, const std::span< std::uint8_t, max_signature_size > out ) noexcept
+    {
+        if ( raw.size() != raw_signature_size )
+            return 0;
+
+        constexpr auto half = raw_signature_size / 2;
+
+        // Both integers are at most 35 bytes with their headers, so the length of the sequence always fits in a single byte.
+        auto size = std::size_t{ 2 };
+        size += encode_integer( raw.substr( 0, half ), out.data() + size );
+        size += encode_integer( raw.substr( half ), out.data() + size );
+
+        out[ 0 ] = 0x30;
+        out[ 1 ] = static_cast< std::uint8_t >( size - 2 );
+
+        return size;
+    }
+}  // namespace tsar::crypto::der
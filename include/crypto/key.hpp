@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string_view>
+
+namespace tsar::crypto
+{
+    /// <summary>
+    /// A public key that verifies the signatures of the TSAR API, parsed once when the app's client key or a user's session key is
+    /// received. Copies share the parsed key, so the key can be handed to requests on any thread.
+    /// </summary>
+    class key final
+    {
+       public:
+        /// <summary>
+        /// Parses a DER-encoded SubjectPublicKeyInfo.
+        /// </summary>
+        /// <returns>The key, or nothing if the key is invalid.</returns>
+        static std::optional< key > parse( const std::string_view der ) noexcept;
+
+        /// <summary>
+        /// An empty key, that rejects every signature.
+        /// </summary>
+        explicit key() noexcept = default;
+
+        explicit operator bool() const noexcept;
+
+        /// <summary>
+        /// Verifies a raw (r||s) ECDSA signature of a message with SHA-256. The verification contexts are kept with the key and reused by
+        /// every later verification of it, on any thread, and the digest context is reused by every verification on the calling thread.
+        /// </summary>
+        bool verify( const std::string_view message, const std::string_view signature ) const noexcept;
+
+        /// <summary>
+        /// The parsed key, as an `EVP_PKEY*`.
+        /// </summary>
+        void* get() const noexcept;
+
+       private:
+        /// <summary>
+        /// The idle verification contexts of a key, shared by its copies.
+        /// </summary>
+        struct verifiers_t;
+
+        explicit key( void* pkey ) noexcept;
+
+        std::shared_ptr< void > pkey;
+        std::shared_ptr< verifiers_t > verifiers;
+    };
+}  // namespace tsar::crypto
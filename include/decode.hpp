@@ -0,0 +1,573 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+
+#include "base64.hpp"
+#include "crypto/key.hpp"
+
+/// <summary>
+/// Decodes verified payloads straight into typed structs. The fields of a struct are described at compile time by specializing
+/// `descriptor_t`, and a SAX reader writes every JSON value into the member it belongs to while the payload is parsed. No DOM is built,
+/// unknown fields are skipped without being stored, and strings are moved into place.
+/// </summary>
+namespace tsar::decode
+{
+    /// <summary>
+    /// A field of a struct: its key in the JSON object, and the member it is decoded into.
+    /// </summary>
+    template< typename T, typename M >
+    struct field_t
+    {
+        using member_t = M;
+
+        std::string_view name;
+        M T::*member;
+    };
+
+    template< typename T, typename M >
+    constexpr field_t< T, M > field( const std::string_view name, M T::*member ) noexcept
+    {
+        return { name, member };
+    }
+
+    /// <summary>
+    /// Describes the fields of a struct that is decoded from a JSON object. Specializations provide a `fields` tuple of `field` values.
+    /// Fields of optional type may be missing or null, every other field is required.
+    /// </summary>
+    template< typename T >
+    struct descriptor_t;
+
+    /// <summary>
+    /// The top-level object of a payload, whose `data` field holds the struct.
+    /// </summary>
+    template< typename T >
+    struct payload_t
+    {
+        T data;
+    };
+
+    template< typename T >
+    struct descriptor_t< payload_t< T > >
+    {
+        static constexpr auto fields = std::make_tuple( field( "data", &payload_t< T >::data ) );
+    };
+
+    template< typename T >
+    concept described = requires { descriptor_t< T >::fields; };
+
+    /// <summary>
+    /// Calls a function with the index and the descriptor of every field of a described struct.
+    /// </summary>
+    template< described T, typename F >
+    constexpr void for_each_field( F&& function )
+    {
+        constexpr auto& fields = descriptor_t< T >::fields;
+        constexpr auto count = std::tuple_size_v< std::remove_cvref_t< decltype( fields ) > >;
+
+        static_assert( count <= 64, "A struct can have at most 64 fields." );
+
+        [ & ]< std::size_t... I >( std::index_sequence< I... > )
+        {
+            ( function( std::integral_constant< std::size_t, I >{}, std::get< I >( fields ) ), ... );
+        }( std::make_index_sequence< count >() );
+    }
+
+    template< typename T >
+    struct is_optional : std::false_type
+    {
+    };
+
+    template< typename T >
+    struct is_optional< std::optional< T > > : std::true_type
+    {
+    };
+
+    /// <summary>
+    /// Writes JSON scalars into a member of type M. Each specialization provides the conversions that are valid for its type, a value
+    /// of any other JSON type fails the decoding.
+    /// </summary>
+    template< typename M >
+    struct value_t
+    {
+    };
+
+    template<>
+    struct value_t< std::string >
+    {
+        static bool string( std::string& member, std::string& value ) noexcept
+        {
+            member = std::move( value );
+            return true;
+        }
+    };
+
+    template< typename M >
+        requires std::is_integral_v< M > && ( !std::is_same_v< M, bool > )
+    struct value_t< M >
+    {
+        static bool integer( M& member, const std::int64_t value ) noexcept
+        {
+            if ( !std::in_range< M >( value ) )
+                return false;
+
+            member = static_cast< M >( value );
+            return true;
+        }
+
+        static bool unsigned_integer( M& member, const std::uint64_t value ) noexcept
+        {
+            if ( !std::in_range< M >( value ) )
+                return false;
+
+            member = static_cast< M >( value );
+            return true;
+        }
+    };
+
+    /// <summary>
+    /// A timestamp, in seconds since the Unix epoch.
+    /// </summary>
+    template<>
+    struct value_t< std::chrono::system_clock::time_point >
+    {
+        static bool integer( std::chrono::system_clock::time_point& member, const std::int64_t value ) noexcept
+        {
+            member = std::chrono::system_clock::from_time_t( static_cast< std::time_t >( value ) );
+            return true;
+        }
+
+        static bool unsigned_integer( std::chrono::system_clock::time_point& member, const std::uint64_t value ) noexcept
+        {
+            if ( !std::in_range< std::time_t >( value ) )
+                return false;
+
+            member = std::chrono::system_clock::from_time_t( static_cast< std::time_t >( value ) );
+            return true;
+        }
+    };
+
+    /// <summary>
+    /// A public key, in base64 encoded DER format.
+    /// </summary>
+    template<>
+    struct value_t< crypto::key >
+    {
+        static bool string( crypto::key& member, std::string& value ) noexcept
+        {
+            // The string was read for this field only, so it is decoded in place.
+            if ( !base64::try_decode_in_place( value ) )
+                return false;
+
+            auto parsed = crypto::key::parse( value );
+
+            if ( !parsed )
+                return false;
+
+            member = std::move( *parsed );
+            return true;
+        }
+    };
+
+    struct handler_t;
+
+    /// <summary>
+    /// A value that is being decoded: the object it is written to, and how.
+    /// </summary>
+    struct target_t
+    {
+        void* object;
+        const handler_t* handler;
+    };
+
+    /// <summary>
+    /// The type-erased conversions of a member type. Conversions that are not valid for the type fail.
+    /// </summary>
+    struct handler_t
+    {
+        bool ( *null )( void* object ) noexcept;
+        bool ( *integer )( void* object, std::int64_t value ) noexcept;
+        bool ( *unsigned_integer )( void* object, std::uint64_t value ) noexcept;
+        bool ( *string )( void* object, std::string& value ) noexcept;
+
+        /// <summary>
+        /// Starts decoding an object into the member. Returns the struct the fields are written to, which has no handler if the member
+        /// is not a struct.
+        /// </summary>
+        target_t ( *begin )( void* object ) noexcept;
+
+        /// <summary>
+        /// Gets the member of a field of the struct, and marks the field as seen. Returns no object for an unknown field.
+        /// </summary>
+        target_t ( *field )( void* object, std::string_view key, std::uint64_t& seen ) noexcept;
+
+        /// <summary>
+        /// The mask of the fields of the struct that must be seen.
+        /// </summary>
+        std::uint64_t required;
+    };
+
+    template< typename M >
+    struct handler_of;
+
+    template< typename M >
+    constexpr const handler_t* handler_for() noexcept
+    {
+        return &handler_of< M >::value;
+    }
+
+    template< typename M >
+    struct handler_of
+    {
+        static bool null( void* object ) noexcept
+        {
+            if constexpr ( is_optional< M >::value )
+            {
+                static_cast< M* >( object )->reset();
+                return true;
+            }
+            else
+                return false;
+        }
+
+        static bool integer( void* object, const std::int64_t value ) noexcept
+        {
+            if constexpr ( is_optional< M >::value )
+                return handler_for< typename M::value_type >()->integer( &static_cast< M* >( object )->emplace(), value );
+            else if constexpr ( requires( M& member ) { value_t< M >::integer( member, value ); } )
+                return value_t< M >::integer( *static_cast< M* >( object ), value );
+            else
+                return false;
+        }
+
+        static bool unsigned_integer( void* object, const std::uint64_t value ) noexcept
+        {
+            if constexpr ( is_optional< M >::value )
+                return handler_for< typename M::value_type >()->unsigned_integer( &static_cast< M* >( object )->emplace(), value );
+            else if constexpr ( requires( M& member ) { value_t< M >::unsigned_integer( member, value ); } )
+                return value_t< M >::unsigned_integer( *static_cast< M* >( object ), value );
+            else
+                return false;
+        }
+
+        static bool string( void* object, std::string& value ) noexcept
+        {
+            if constexpr ( is_optional< M >::value )
+                return handler_for< typename M::value_type >()->string( &static_cast< M* >( object )->emplace(), value );
+            else if constexpr ( requires( M& member ) { value_t< M >::string( member, value ); } )
+                return value_t< M >::string( *static_cast< M* >( object ), value );
+            else
+                return false;
+        }
+
+        static target_t begin( void* object ) noexcept
+        {
+            if constexpr ( is_optional< M >::value )
+                return handler_for< typename M::value_type >()->begin( &static_cast< M* >( object )->emplace() );
+            else if constexpr ( described< M > )
+                return { object, handler_for< M >() };
+            else
+                return { nullptr, nullptr };
+        }
+
+        static target_t field( void* object, const std::string_view key, std::uint64_t& seen ) noexcept
+        {
+            target_t target{ nullptr, nullptr };
+
+            if constexpr ( described< M > )
+            {
+                for_each_field< M >( [ & ]( const auto index, const auto& field )
+                {
+                    using member_t = typename std::remove_cvref_t< decltype( field ) >::member_t;
+
+                    // Like a DOM, a repeated key replaces the previous value.
+                    if ( field.name == key )
+                    {
+                        seen |= std::uint64_t{ 1 } << index;
+                        target = { &( static_cast< M* >( object )->*field.member ), handler_for< member_t >() };
+                    }
+                } );
+            }
+
+            return target;
+        }
+
+        static constexpr std::uint64_t required() noexcept
+        {
+            std::uint64_t mask = 0;
+
+            if constexpr ( described< M > )
+            {
+                for_each_field< M >( [ & ]( const auto index, const auto& field )
+                {
+                    using member_t = typename std::remove_cvref_t< decltype( field ) >::member_t;
+
+                    if ( !is_optional< member_t >::value )
+                        mask |= std::uint64_t{ 1 } << index;
+                } );
+            }
+
+            return mask;
+        }
+
+        static constexpr handler_t value{ &null, &integer, &unsigned_integer, &string, &begin, &field, required() };
+    };
+
+    /// <summary>
+    /// The SAX reader that feeds the events of the JSON parser into the targets of the described structs.
+    /// </summary>
+    class reader final
+    {
+       public:
+        using json = nlohmann::json;
+
+        /// <summary>
+        /// The deepest nesting of described structs. Skipped values may be nested deeper.
+        /// </summary>
+        static constexpr std::size_t max_depth = 16;
+
+        explicit reader( target_t root ) noexcept : pending( root ), depth( 0 ), skipped( 0 )
+        {
+        }
+
+        bool null()
+        {
+            return scalar( [ this ] { return pending.handler->null( pending.object ); } );
+        }
+
+        bool boolean( bool )
+        {
+            return scalar( [] { return false; } );
+        }
+
+        bool number_integer( json::number_integer_t value )
+        {
+            return scalar( [ this, value ] { return pending.handler->integer( pending.object, value ); } );
+        }
+
+        bool number_unsigned( json::number_unsigned_t value )
+        {
+            return scalar( [ this, value ] { return pending.handler->unsigned_integer( pending.object, value ); } );
+        }
+
+        bool number_float( json::number_float_t, const json::string_t& )
+        {
+            return scalar( [] { return false; } );
+        }
+
+        bool string( json::string_t& value )
+        {
+            return scalar( [ this, &value ] { return pending.handler->string( pending.object, value ); } );
+        }
+
+        bool binary( json::binary_t& )
+        {
+            return scalar( [] { return false; } );
+        }
+
+        bool start_object( std::size_t )
+        {
+            if ( skipping() )
+                return true;
+
+            const auto target = pending.handler->begin( pending.object );
+
+            if ( !target.handler || depth == max_depth )
+                return false;
+
+            frames[ depth++ ] = { target, 0 };
+            return true;
+        }
+
+        bool key( json::string_t& key )
+        {
+            if ( skipped )
+                return true;
+
+            auto& frame = frames[ depth - 1 ];
+            pending = frame.target.handler->field( frame.target.object, key, frame.seen );
+
+            return true;
+        }
+
+        bool end_object()
+        {
+            if ( skipped )
+                return --skipped, true;
+
+            const auto& frame = frames[ --depth ];
+            return ( frame.seen & frame.target.handler->required ) == frame.target.handler->required;
+        }
+
+        bool start_array( std::size_t )
+        {
+            // No described field is an array.
+            return skipping();
+        }
+
+        bool end_array()
+        {
+            return --skipped, true;
+        }
+
+        bool parse_error( std::size_t, const std::string&, const nlohmann::detail::exception& )
+        {
+            return false;
+        }
+
+       private:
+        /// <summary>
+        /// Whether the value that starts is skipped, either because it belongs to an unknown field or is nested in a skipped value.
+        /// </summary>
+        bool skipping() noexcept
+        {
+            if ( skipped || !pending.object )
+                return ++skipped, true;
+
+            return false;
+        }
+
+        template< typename Write >
+        bool scalar( Write&& write )
+        {
+            if ( skipped || !pending.object )
+                return true;
+
+            return write();
+        }
+
+        struct frame_t
+        {
+            target_t target;
+            std::uint64_t seen;
+        };
+
+        target_t pending;
+
+        frame_t frames[ max_depth ];
+        std::size_t depth, skipped;
+    };
+
+    /// <summary>
+    /// Decodes a JSON object into a described struct.
+    /// </summary>
+    /// <returns>False if the JSON is malformed, a required field is missing, or a field has the wrong type.</returns>
+    template< described T >
+    bool decode( const std::string_view json, T& out ) noexcept
+    {
+        try
+        {
+            reader sax( { &out, handler_for< T >() } );
+            return nlohmann::json::sax_parse( json.begin(), json.end(), &sax );
+        }
+        catch ( const std::exception& )
+        {
+            return false;
+        }
+    }
+
+    /// <summary>
+    /// Feeds a JSON value that has already been parsed into a SAX reader, as the events the parser would have produced for it.
+    /// </summary>
+    inline bool replay( const nlohmann::json& value, reader& sax )
+    {
+        using json = nlohmann::json;
+
+        switch ( value.type() )
+        {
+            case json::value_t::null:
+                return sax.null();
+            case json::value_t::boolean:
+                return sax.boolean( value.get< bool >() );
+            case json::value_t::number_integer:
+                return sax.number_integer( value.get< json::number_integer_t >() );
+            case json::value_t::number_unsigned:
+                return sax.number_unsigned( value.get< json::number_unsigned_t >() );
+            case json::value_t::number_float:
+                return sax.number_float( value.get< json::number_float_t >(), {} );
+            case json::value_t::string:
+            {
+                // The reader moves strings into place, so it gets a copy.
+                auto copy = value.get< json::string_t >();
+                return sax.string( copy );
+            }
+            case json::value_t::binary:
+            {
+                auto copy = value.get_binary();
+                return sax.binary( copy );
+            }
+            case json::value_t::object:
+            {
+                if ( !sax.start_object( value.size() ) )
+                    return false;
+
+                for ( auto it = value.begin(); it != value.end(); ++it )
+                {
+                    auto key = it.key();
+
+                    if ( !sax.key( key ) || !replay( it.value(), sax ) )
+                        return false;
+                }
+
+                return sax.end_object();
+            }
+            case json::value_t::array:
+            {
+                if ( !sax.start_array( value.size() ) )
+                    return false;
+
+                for ( const auto& element : value )
+                {
+                    if ( !replay( element, sax ) )
+                        return false;
+                }
+
+                return sax.end_array();
+            }
+            default:
+                return false;
+        }
+    }
+
+    /// <summary>
+    /// Decodes a JSON object that has already been parsed into a described struct, with the same checks as `decode`.
+    /// </summary>
+    /// <returns>False if a required field is missing, or a field has the wrong type.</returns>
+    template< described T >
+    bool decode_dom( const nlohmann::json& json, T& out ) noexcept
+    {
+        try
+        {
+            reader sax( { &out, handler_for< T >() } );
+            return replay( json, sax );
+        }
+        catch ( const std::exception& )
+        {
+            return false;
+        }
+    }
+
+    /// <summary>
+    /// Decodes the `data` field of a verified payload into a described struct.
+    /// </summary>
+    template< described T >
+    bool decode_payload( const std::string_view json, T& out ) noexcept
+    {
+        payload_t< T > payload;
+
+        if ( !decode( json, payload ) )
+            return false;
+
+        out = std::move( payload.data );
+        return true;
+    }
+}  // namespace tsar::decode
@@ -142,6 +142,11 @@ namespace tsar
         /// The program hash is not authorized.
         /// </summary>
         hash_unauthorized_t,
+
+        /// <summary>
+        /// The response body exceeded the maximum response size.
+        /// </summary>
+        response_too_large_t,
     };
 
     /// <summary>
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace tsar::http
+{
+    /// <summary>
+    /// Per-thread scratch memory for the request that is being processed on a thread. The response buffers and the decoded payload of a
+    /// request are allocated from the arena, which is reset by the next request on the same thread instead of freeing them one by one. The
+    /// first 16 KiB live inside the arena itself, so steady-state requests never touch the heap for them.
+    /// </summary>
+    class arena final
+    {
+       public:
+        /// <summary>
+        /// The size of the memory held by the arena itself. Larger requests spill over to the heap until the next reset.
+        /// </summary>
+        static constexpr std::size_t inline_size = 16 * 1024;
+
+        /// <summary>
+        /// Gets the arena of the calling thread.
+        /// </summary>
+        static arena& local() noexcept;
+
+        arena( const arena& ) = delete;
+        arena& operator=( const arena& ) = delete;
+
+        /// <summary>
+        /// Releases everything allocated from the arena. Must not be called while anything allocated from it is still in use.
+        /// </summary>
+        /// <returns>The memory resource of the arena.</returns>
+        std::pmr::memory_resource* reset() noexcept;
+
+       private:
+        explicit arena() noexcept;
+
+        alignas( std::max_align_t ) std::byte buffer[ inline_size ];
+        std::pmr::monotonic_buffer_resource resource;
+    };
+}  // namespace tsar::http
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "envelope.hpp"
+#include "pool.hpp"
+
+namespace tsar::http
+{
+    /// <summary>
+    /// An asynchronous request engine built on the cURL multi interface. A single I/O thread drives every in-flight request of the
+    /// process, and requests to the same host are multiplexed over one HTTP/2 connection when the server offers it.
+    /// </summary>
+    class engine final
+    {
+       public:
+        /// <summary>
+        /// Invoked on the I/O thread once a request completes. The status code is zero if the request failed.
+        /// </summary>
+        using callback_t = std::function< void( long status_code, envelope& body ) >;
+
+        /// <summary>
+        /// Gets the engine shared by the whole process. The I/O thread is started on the first request.
+        /// </summary>
+        static engine& get() noexcept;
+
+        engine( const engine& ) = delete;
+        engine& operator=( const engine& ) = delete;
+
+        ~engine();
+
+        /// <summary>
+        /// Queues a GET request for the specified URL. The handle is leased from the pool, which is kept alive until the request completes.
+        /// </summary>
+        /// <param name="delay">The time to hold the request back before it is started, e.g. because it was throttled.</param>
+        /// <returns>True if the request was queued. If false, the callback is never invoked.</returns>
+        bool submit( std::shared_ptr< http::pool > pool,
+                     std::string url,
+                     callback_t callback,
+                     std::chrono::steady_clock::duration delay = std::chrono::steady_clock::duration::zero() ) noexcept;
+
+        /// <summary>
+        /// Gets the number of requests that have been submitted but not completed yet.
+        /// </summary>
+        std::size_t in_flight() const noexcept;
+
+       private:
+        /// <summary>
+        /// A request owned by the engine.
+        /// </summary>
+        struct transfer_t
+        {
+            std::shared_ptr< http::pool > pool;
+            pool::lease handle;
+            std::string url;
+            envelope body;
+            callback_t callback;
+            std::chrono::steady_clock::time_point not_before;
+        };
+
+        explicit engine() noexcept;
+
+        /// <summary>
+        /// The loop of the I/O thread.
+        /// </summary>
+        void run() noexcept;
+
+        /// <summary>
+        /// Adds the queued requests that are due to the multi handle. Delayed requests are started regardless if `all` is true.
+        /// </summary>
+        /// <returns>The number of milliseconds until the next delayed request is due, at most one second.</returns>
+        int start_pending( bool all = false ) noexcept;
+
+        /// <summary>
+        /// Removes a request from the multi handle and invokes its callback.
+        /// </summary>
+        void complete( void* curl, long status_code ) noexcept;
+
+        void* multi;
+
+        mutable std::mutex mutex;
+        std::vector< std::unique_ptr< transfer_t > > pending;
+
+        /// <summary>
+        /// The requests that are attached to the multi handle, keyed by their easy handle. Only touched by the I/O thread.
+        /// </summary>
+        std::unordered_map< void*, std::unique_ptr< transfer_t > > active;
+
+        std::atomic< std::size_t > count;
+        std::atomic< bool > stopping;
+
+        std::once_flag started;
+        std::thread thread;
+    };
+}  // namespace tsar::http
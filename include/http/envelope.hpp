@@ -0,0 +1,190 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "../base64.hpp"
+
+namespace tsar::http
+{
+    /// <summary>
+    /// A single-pass parser for the body of a TSAR API response. The body is a JSON object that carries the signed payload in its `data`
+    /// field and the signature in its `signature` field. The parser is fed straight from the cURL write callback and extracts both string
+    /// fields as they arrive, skipping every other value without building a DOM. Skipped values are only checked for balanced nesting, since
+    /// nothing outside of the signed payload is trusted anyway. The `data` field is base64-decoded while it is received, so the encoded
+    /// payload is never buffered.
+    /// </summary>
+    class envelope final
+    {
+       public:
+        /// <summary>
+        /// The state of the parser.
+        /// </summary>
+        enum class state_t
+        {
+            /// <summary>
+            /// The top-level object has not been closed yet.
+            /// </summary>
+            parsing,
+
+            /// <summary>
+            /// The top-level object has been parsed completely.
+            /// </summary>
+            complete,
+
+            /// <summary>
+            /// The body is not a valid JSON object.
+            /// </summary>
+            malformed,
+
+            /// <summary>
+            /// The body exceeded the maximum size.
+            /// </summary>
+            too_large
+        };
+
+        /// <summary>
+        /// The default maximum size of a response body, in bytes.
+        /// </summary>
+        static constexpr std::size_t default_max_size = 1024 * 1024;
+
+        /// <param name="max_size">The maximum size of the body, in bytes.</param>
+        /// <param name="resource">The memory resource the captured fields are allocated from.</param>
+        explicit envelope( std::size_t max_size = default_max_size, std::pmr::memory_resource* resource = std::pmr::get_default_resource() ) noexcept;
+
+        /// <summary>
+        /// Sets the write and header callbacks of a cURL easy handle so that the response body is fed into this parser.
+        /// </summary>
+        void attach( void* curl ) noexcept;
+
+        /// <summary>
+        /// Pre-sizes the field buffers from the announced length of the body.
+        /// </summary>
+        void reserve( std::size_t content_length ) noexcept;
+
+        /// <summary>
+        /// Parses the next chunk of the body.
+        /// </summary>
+        /// <returns>False if the body exceeded the maximum size and the transfer should be aborted.</returns>
+        bool feed( const std::string_view chunk ) noexcept;
+
+        /// <summary>
+        /// Gets the state of the parser. A body that ends before its top-level object is closed is malformed.
+        /// </summary>
+        state_t finish() const noexcept;
+
+        /// <summary>
+        /// The decoded value of the `data` field. Only valid if `has_data()` and `data_decoded()` are true.
+        /// </summary>
+        std::pmr::string& data() noexcept;
+
+        /// <summary>
+        /// The unescaped value of the `signature` field. Only valid if `has_signature()` is true.
+        /// </summary>
+        std::pmr::string& signature() noexcept;
+
+        bool has_data() const noexcept;
+        bool has_signature() const noexcept;
+
+        /// <summary>
+        /// Whether the `data` field is valid base64.
+        /// </summary>
+        bool data_decoded() const noexcept;
+
+        /// <summary>
+        /// Sets the delay of the Retry-After header of the response.
+        /// </summary>
+        void set_retry_after( std::chrono::seconds delay ) noexcept;
+
+        /// <summary>
+        /// The delay the server asked for in the Retry-After header of the response, if it sent one.
+        /// </summary>
+        std::optional< std::chrono::seconds > retry_after() const noexcept;
+
+       private:
+        /// <summary>
+        /// The position of the parser in the body.
+        /// </summary>
+        enum class position_t : std::uint8_t
+        {
+            before_object,
+            before_key,
+            in_key,
+            key_escape,
+            before_colon,
+            before_value,
+            in_field,
+            field_escape,
+            field_unicode,
+            in_skipped,
+            after_value,
+            after_object
+        };
+
+        /// <summary>
+        /// The field a string value is written to.
+        /// </summary>
+        enum class field_t : std::uint8_t
+        {
+            none,
+            data,
+            signature
+        };
+
+        /// <summary>
+        /// Skips a value that is not captured. Returns the number of characters consumed.
+        /// </summary>
+        std::size_t skip( const std::string_view chunk ) noexcept;
+
+        /// <summary>
+        /// Captures the characters of a string field. Returns the number of characters consumed.
+        /// </summary>
+        std::size_t capture( const std::string_view chunk );
+
+        /// <summary>
+        /// Appends an unescaped character or code point to the current field.
+        /// </summary>
+        void append( std::uint32_t code_point );
+
+        /// <summary>
+        /// Appends unescaped characters to the current field, decoding them if it is the `data` field.
+        /// </summary>
+        void write( const std::string_view text );
+
+        std::pmr::string data_field, signature_field;
+        bool data_set, signature_set;
+
+        base64::decoder data_decoder;
+        bool data_valid;
+
+        std::optional< std::chrono::seconds > retry_after_header;
+
+        std::size_t max_size, received;
+
+        state_t state;
+        position_t position;
+        field_t field;
+
+        /// <summary>
+        /// The key being read. Keys longer than any captured key are only tracked as unknown.
+        /// </summary>
+        char key[ 10 ];
+        std::size_t key_size;
+
+        /// <summary>
+        /// Nesting depth, string and escape flags of a skipped value.
+        /// </summary>
+        std::size_t depth;
+        bool in_string, escaped;
+
+        /// <summary>
+        /// The code point and the number of hexadecimal digits read of a \u escape.
+        /// </summary>
+        std::uint32_t code_point;
+        std::uint8_t digits;
+    };
+}  // namespace tsar::http
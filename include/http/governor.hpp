@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string_view>
+
+namespace tsar::http
+{
+    /// <summary>
+    /// Paces the requests of a client so that they stay under the rate limits of the TSAR API. Every class of endpoint has its own token
+    /// bucket, and a class that was rate limited by the server backs off for the time the server asked for, or for a jittered exponential
+    /// delay if it did not say.
+    /// </summary>
+    class governor final
+    {
+       public:
+        using clock = std::chrono::steady_clock;
+
+        /// <summary>
+        /// The classes of endpoints that are limited independently.
+        /// </summary>
+        enum class endpoint_t
+        {
+            initialize,
+            authenticate,
+            heartbeat,
+            other
+        };
+
+        /// <summary>
+        /// The token bucket of a class of endpoints.
+        /// </summary>
+        struct limit_t
+        {
+            /// <summary>
+            /// The number of requests per second the bucket refills. Zero disables the bucket.
+            /// </summary>
+            double rate;
+
+            /// <summary>
+            /// The number of requests that may be sent in a burst.
+            /// </summary>
+            double burst;
+        };
+
+        /// <summary>
+        /// Throttling statistics of the governor.
+        /// </summary>
+        struct stats_t
+        {
+            /// <summary>
+            /// The number of requests that had to wait before being sent.
+            /// </summary>
+            std::uint64_t throttled;
+
+            /// <summary>
+            /// The number of requests that were failed locally with `error_code_t::rate_limited_t` instead of being sent.
+            /// </summary>
+            std::uint64_t rejected;
+
+            /// <summary>
+            /// The total time requests spent waiting.
+            /// </summary>
+            std::chrono::milliseconds throttled_time;
+        };
+
+        explicit governor() noexcept;
+
+        /// <summary>
+        /// Gets the class of an endpoint such as "heartbeat?session=...".
+        /// </summary>
+        static endpoint_t classify( const std::string_view endpoint ) noexcept;
+
+        /// <summary>
+        /// Sets the token bucket of a class of endpoints.
+        /// </summary>
+        void set_limit( endpoint_t endpoint, limit_t limit ) noexcept;
+
+        /// <summary>
+        /// Sets the longest time a request may be held back. Requests that would have to wait longer are rejected. Defaults to 10 seconds.
+        /// </summary>
+        void set_max_wait( std::chrono::milliseconds max_wait ) noexcept;
+
+        /// <summary>
+        /// Reserves a request of the specified class.
+        /// </summary>
+        /// <returns>The time the request has to wait before it is sent, or nothing if it has to be rejected.</returns>
+        std::optional< clock::duration > reserve( endpoint_t endpoint ) noexcept;
+
+        /// <summary>
+        /// Records the response of a request, and backs off if the server rate limited it with a 429 or is unavailable with a 503.
+        /// </summary>
+        /// <param name="endpoint">The class of the request.</param>
+        /// <param name="status_code">The HTTP status code of the response.</param>
+        /// <param name="retry_after">The delay of the Retry-After header of the response, if any.</param>
+        void record( endpoint_t endpoint, long status_code, std::optional< std::chrono::seconds > retry_after ) noexcept;
+
+        /// <summary>
+        /// Gets the throttling statistics of the governor.
+        /// </summary>
+        stats_t stats() const noexcept;
+
+       private:
+        /// <summary>
+        /// The state of a class of endpoints.
+        /// </summary>
+        struct bucket_t
+        {
+            limit_t limit;
+            double tokens;
+            clock::time_point updated, blocked_until;
+            std::uint32_t failures;
+        };
+
+        mutable std::mutex mutex;
+        std::array< bucket_t, 4 > buckets;
+        clock::duration max_wait;
+
+        std::minstd_rand random;
+
+        std::uint64_t throttled, rejected;
+        clock::duration throttled_time;
+    };
+}  // namespace tsar::http
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "envelope.hpp"
+#include "governor.hpp"
+
+namespace tsar::http
+{
+    /// <summary>
+    /// Performs the process-wide cURL initialization exactly once. Must be called before the first cURL handle is created.
+    /// </summary>
+    /// <returns>True if cURL was initialized successfully.</returns>
+    extern bool global_init() noexcept;
+
+    /// <summary>
+    /// A thread-safe pool of reusable cURL easy handles. Every handle in the pool is attached to one share object that holds the
+    /// connection cache, the TLS session cache and the DNS cache, so steady-state requests reuse a warm keep-alive connection.
+    /// </summary>
+    class pool final
+    {
+       public:
+        /// <summary>
+        /// Connection statistics of the pool.
+        /// </summary>
+        struct stats_t
+        {
+            /// <summary>
+            /// The number of requests that were performed through the pool.
+            /// </summary>
+            std::uint64_t requests;
+
+            /// <summary>
+            /// The number of requests that reused an already established connection.
+            /// </summary>
+            std::uint64_t reused_connections;
+        };
+
+        /// <summary>
+        /// A handle that has been checked out of the pool. The handle is returned to the pool when the lease is destroyed.
+        /// </summary>
+        class lease final
+        {
+            friend class pool;
+
+            pool* owner;
+            void* curl;
+
+            /// <summary>
+            /// The addresses of the request's host, pinned from the shared resolver cache.
+            /// </summary>
+            void* resolve;
+
+            explicit lease( pool* owner, void* curl ) noexcept;
+
+           public:
+            lease( const lease& ) = delete;
+            lease& operator=( const lease& ) = delete;
+
+            lease( lease&& other ) noexcept;
+            ~lease();
+
+            /// <summary>
+            /// The leased cURL easy handle. Null if the pool failed to create a handle.
+            /// </summary>
+            void* handle() const noexcept;
+
+            /// <summary>
+            /// Sets the URL of the request, and pins its host to every address held by the shared resolver cache so that cURL does not
+            /// resolve the host again, but can still fall back between them.
+            /// </summary>
+            void set_url( const std::string& url ) noexcept;
+
+            explicit operator bool() const noexcept;
+        };
+
+        explicit pool( std::size_t max_idle = 8 ) noexcept;
+        ~pool();
+
+        pool( const pool& ) = delete;
+        pool& operator=( const pool& ) = delete;
+
+        /// <summary>
+        /// Checks a handle out of the pool, creating a new one if no idle handle is available.
+        /// </summary>
+        lease acquire() noexcept;
+
+        /// <summary>
+        /// Performs the request configured on the leased handle and records whether a connection was reused.
+        /// </summary>
+        /// <returns>True if the transfer completed.</returns>
+        bool perform( const lease& handle ) noexcept;
+
+        /// <summary>
+        /// Records a transfer that was performed on a leased handle outside of the pool, e.g. by the multi interface.
+        /// </summary>
+        void record( const lease& handle, bool completed ) noexcept;
+
+        /// <summary>
+        /// Gets the connection statistics of the pool.
+        /// </summary>
+        stats_t stats() const noexcept;
+
+        /// <summary>
+        /// The maximum size of a response body received through the pool, in bytes.
+        /// </summary>
+        std::size_t max_response_size() const noexcept;
+
+        void set_max_response_size( std::size_t bytes ) noexcept;
+
+        /// <summary>
+        /// The rate governor that paces the requests sent through the pool.
+        /// </summary>
+        http::governor& governor() noexcept;
+
+       private:
+        /// <summary>
+        /// Returns a handle to the pool, or destroys it if the pool already holds enough idle handles.
+        /// </summary>
+        void release( void* curl ) noexcept;
+
+        /// <summary>
+        /// Attaches the share object and the keep-alive options to a handle.
+        /// </summary>
+        void configure( void* curl ) const noexcept;
+
+        /// <summary>
+        /// The share object used by all handles of the pool.
+        /// </summary>
+        void* share;
+
+        /// <summary>
+        /// One lock per type of data held by the share object.
+        /// </summary>
+        std::array< std::mutex, 16 > locks;
+
+        std::mutex mutex;
+        std::vector< void* > idle;
+        std::size_t max_idle;
+
+        /// <summary>
+        /// The last host:port:addresses entry pinned in the shared DNS cache.
+        /// </summary>
+        std::string pinned;
+
+        std::atomic< std::uint64_t > requests, reused;
+        std::atomic< std::size_t > max_response;
+
+        http::governor limiter;
+    };
+}  // namespace tsar::http
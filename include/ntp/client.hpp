@@ -8,7 +8,15 @@
 
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <span>
 #include <string>
+#include <thread>
+#include <vector>
 #ifdef _WIN32
 #include <WinSock2.h>
 using socket_t = SOCKET;
@@ -19,6 +27,11 @@ using socket_t = int;
 
 #include "../error.hpp"
 
+namespace tsar
+{
+    class resolver;
+}  // namespace tsar
+
 namespace tsar::ntp
 {
     /// <summary>
@@ -106,60 +119,227 @@ namespace tsar::ntp
     };
 
     /// <summary>
-    /// A class that defines the NTP client.
+    /// A class that defines the NTP client. Every server is queried in parallel, and the time is taken from the response with the lowest
+    /// round-trip delay. If opted in, a system clock that the kernel reports as synchronized is used as is instead. The NTP time is measured once and then extrapolated with the steady clock, while a background thread measures it
+    /// again on an interval, or early if the system clock was set.
     /// </summary>
     class client final
     {
+       public:
+        /// <summary>
+        /// Where the time is measured from.
+        /// </summary>
+        enum class source_t
+        {
+            /// <summary>
+            /// Always the NTP servers. The default.
+            /// </summary>
+            network,
+
+            /// <summary>
+            /// The system clock if the kernel reports it as synchronized, or else the NTP servers. The kernel state can be set by anyone who
+            /// controls the machine, so this trusts the local clock.
+            /// </summary>
+            automatic
+        };
+
+        /// <summary>
+        /// The default maximum error the kernel may report for the system clock to be used without querying the NTP servers.
+        /// </summary>
+        static constexpr std::chrono::milliseconds default_kernel_tolerance{ 1000 };
+
+       private:
+        /// <summary>
+        /// A measurement of the NTP time, with the system and steady clocks at the time it was received.
+        /// </summary>
+        struct sample_t
+        {
+            std::chrono::system_clock::time_point ntp_time, system_time;
+            std::chrono::steady_clock::time_point steady_time;
+        };
+
+        /// <summary>
+        /// An NTP server, with its socket and the request that is in flight to it.
+        /// </summary>
+        struct server_t
+        {
+            std::string hostname;
+            std::uint16_t port;
+            socket_t socket_fd = static_cast< socket_t >( -1 );
+
+            /// <summary>
+            /// The random tag of the request in flight, echoed in the originate timestamp of the response, and the system time it was sent at.
+            /// </summary>
+            std::uint64_t tag = 0;
+            std::chrono::system_clock::time_point sent{};
+            bool pending = false;
+        };
+
+        /// <summary>
+        /// Measures the NTP time. Callers that arrive while a measurement is in flight share its result.
+        /// </summary>
+        result_t< sample_t > measure();
+
+        /// <summary>
+        /// Reads the system clock as a measurement, if the kernel reports it as synchronized with a maximum error within the tolerance.
+        /// Only supported on Linux.
+        /// </summary>
+        std::optional< sample_t > kernel_sample() const noexcept;
+
+        /// <summary>
+        /// Measures the NTP time again whenever the refresh interval passes or a jump of the system clock is detected, until the client is
+        /// destroyed.
+        /// </summary>
+        void refresh_loop();
+
         /// <summary>
         /// Converts from hostname to ip address.
         /// </summary>
         /// <param name="hostname">Name of the host.</param>
-        /// <returns>IP address. Return empty string if can't find the ip.</returns>
-        std::string hostname_to_ip( const std::string_view hostname );
+        /// <param name="address">Receives the IP address, followed by a null terminator.</param>
+        /// <returns>False if the ip can't be found.</returns>
+        bool hostname_to_ip( const std::string_view hostname, std::span< char > address );
 
         /// <summary>
-        /// Build the connection. Set all the params for the socket_client.
+        /// Build the connection. Resolves the server, and connects a new non-blocking socket to it.
         /// </summary>
-        result_t< void > build_connection() noexcept;
+        result_t< void > build_connection( server_t& server ) noexcept;
 
         /// <summary>
-        /// Close the connection. Set -1 to socket_fd.
+        /// Sends tagged requests to every server until one is answered or the attempts run out, and picks the best response. Only called by
+        /// the caller whose measurement is in flight.
         /// </summary>
-        void close_socket();
+        result_t< sample_t > query() noexcept;
 
         /// <summary>
-        /// NTP server IP address
+        /// Close the connection. Set -1 to socket_fd.
         /// </summary>
-        std::string hostname;
+        void close_socket( server_t& server );
 
         /// <summary>
-        /// NTP server port
+        /// Converts an NTP timestamp in network byte order to a point of the system clock.
         /// </summary>
-        std::uint16_t port;
+        static std::chrono::system_clock::time_point to_time_point( std::uint32_t seconds, std::uint32_t fraction ) noexcept;
 
         /// <summary>
-        /// Socket file descriptor
+        /// Resolves the hostnames of the servers. It is taken when the client is created, so that the shared resolver is created first and
+        /// only destroyed once the client and its refresh thread are gone, even when the client itself is a static.
         /// </summary>
-        socket_t socket_fd;
+        resolver& names;
 
         /// <summary>
-        /// Server address data structure
+        /// The NTP servers that are queried.
         /// </summary>
-        struct sockaddr_in socket_client;
+        std::vector< server_t > servers;
 
         /// <summary>
         /// Delta between epoch time and ntp time
         /// </summary>
         static constexpr unsigned long long NTP_TIMESTAMP_DELTA{ 2208988800ull };
 
+        /// <summary>
+        /// The time to wait for the responses to a request, and the number of requests sent before giving up.
+        /// </summary>
+        static constexpr std::chrono::milliseconds attempt_timeout{ 1000 };
+        static constexpr std::size_t max_attempts = 3;
+
+        /// <summary>
+        /// Generates the tags of the requests.
+        /// </summary>
+        std::mt19937_64 random;
+
+        /// <summary>
+        /// Guards the measurement in flight, which is shared by every caller that arrives while it is made. The servers and their sockets
+        /// are only changed while no measurement is in flight.
+        /// </summary>
+        std::mutex request_mutex;
+        std::condition_variable landed;
+        bool in_flight;
+        std::uint64_t flights;
+        result_t< sample_t > last_result;
+
+        /// <summary>
+        /// Where the time is measured from, and the maximum error of a synchronized system clock. Guarded by the request mutex.
+        /// </summary>
+        source_t source;
+        std::chrono::milliseconds kernel_tolerance;
+
+        /// <summary>
+        /// How far the system clock may move apart from the steady clock before it counts as set, and the NTP time is measured again.
+        /// </summary>
+        static constexpr std::chrono::seconds jump_threshold{ 2 };
+
+        /// <summary>
+        /// The minimum time between two measurements, so that a jumping clock or an unreachable server is not queried in a loop.
+        /// </summary>
+        static constexpr std::chrono::seconds minimum_refresh_interval{ 5 };
+
+        /// <summary>
+        /// Guards the sample and the state of the refresh thread.
+        /// </summary>
+        std::mutex mutex;
+        std::condition_variable wake;
+
+        /// <summary>
+        /// The last successful measurement.
+        /// </summary>
+        std::optional< sample_t > sample;
+
+        std::chrono::seconds refresh_interval;
+        bool refresh_requested, stopping;
+        std::thread refresher;
+
        public:
         explicit client( const std::string_view host, std::uint16_t port );
+
+        /// <summary>
+        /// Creates a client that queries every one of the servers, given as host and port pairs.
+        /// </summary>
+        explicit client( std::span< const std::pair< std::string_view, std::uint16_t > > servers );
         ~client();
 
         /// <summary>
-        /// Transmits an NTP request to the defined server and returns the timestamp.
+        /// Changes the NTP server that requests are sent to, replacing every server that was added before.
+        /// </summary>
+        void set_server( const std::string_view host, std::uint16_t port );
+
+        /// <summary>
+        /// Adds an NTP server that requests are sent to, in parallel with the other servers.
+        /// </summary>
+        void add_server( const std::string_view host, std::uint16_t port );
+
+        /// <summary>
+        /// The default interval between two measurements of the NTP time.
+        /// </summary>
+        static constexpr std::chrono::seconds default_refresh_interval{ 600 };
+
+        /// <summary>
+        /// Changes the interval between two measurements of the NTP time, from the next measurement on. Intervals shorter than the
+        /// minimum are raised to it.
+        /// </summary>
+        void set_refresh_interval( std::chrono::seconds interval );
+
+        /// <summary>
+        /// Changes where the time is measured from, from the next measurement on. With the automatic source, the NTP servers are only queried
+        /// if the kernel reports the system clock as unsynchronized, or with a maximum error above the tolerance.
+        ///
+        /// The automatic source saves a network round trip per measurement, but it gives up the independent check of the system clock: a user
+        /// with administrator rights can set the clock back and then mark it as synchronized with adjtimex, or discipline it from a fake time
+        /// server, and old signed responses would pass the freshness check. Only use it where the machine itself is trusted.
+        /// </summary>
+        void set_source( source_t source, std::chrono::milliseconds tolerance = default_kernel_tolerance );
+
+        /// <summary>
+        /// Gets the current NTP time, extrapolated from the last measurement with the steady clock. Only the first call waits for the servers.
+        /// If a later measurement fails, the previous one keeps being used.
+        /// </summary>
+        result_t< std::chrono::system_clock::time_point > now();
+
+        /// <summary>
+        /// Transmits an NTP request to the defined servers and returns the timestamp. Lost requests are sent again up to 3 times, with a
+        /// timeout of a second each. Safe to call from any thread: callers that arrive while a request is in flight share its result.
         /// </summary>
-        /// <returns>The number of seconds since 1970. Return 0 if fail</returns>
+        /// <returns>The number of seconds since 1970, or the error of the request.</returns>
         result_t< time_t > request_time();
     };
-}  // namespace tsar::ntp
\ No newline at end of file
+}  // namespace tsar::ntp
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tsar
+{
+    /// <summary>
+    /// A thread-safe cache of resolved host addresses, shared by the NTP client and the HTTPS requests. Every address of a host is kept, in
+    /// the order the system resolver prefers them. Entries that are still in use are refreshed in the background before they expire, and the
+    /// last good addresses are kept when a lookup fails.
+    /// </summary>
+    class resolver final
+    {
+       public:
+        /// <summary>
+        /// The address family of a lookup.
+        /// </summary>
+        enum class family_t
+        {
+            /// <summary>
+            /// IPv4 addresses only.
+            /// </summary>
+            ipv4,
+
+            /// <summary>
+            /// IPv4 and IPv6 addresses.
+            /// </summary>
+            any
+        };
+
+        /// <summary>
+        /// Gets the resolver shared by the whole process.
+        /// </summary>
+        static resolver& get() noexcept;
+
+        resolver( const resolver& ) = delete;
+        resolver& operator=( const resolver& ) = delete;
+
+        ~resolver();
+
+        /// <summary>
+        /// Resolves a hostname to the textual form of its preferred address. Only the first lookup of a host blocks.
+        /// </summary>
+        /// <param name="host">The hostname.</param>
+        /// <param name="family">The address family.</param>
+        /// <param name="buffer">Receives the address, followed by a null terminator.</param>
+        /// <returns>The length of the address, or zero if the host has never been resolved successfully or the address does not fit.</returns>
+        std::size_t resolve( const std::string_view host, family_t family, std::span< char > buffer ) noexcept;
+
+        /// <summary>
+        /// Resolves a hostname to every one of its addresses, written as a comma-separated list with IPv6 addresses in brackets, the format
+        /// of a cURL resolve entry. Addresses that do not fit into the buffer are left out. Only the first lookup of a host blocks.
+        /// </summary>
+        /// <param name="host">The hostname.</param>
+        /// <param name="family">The address family.</param>
+        /// <param name="buffer">Receives the list.</param>
+        /// <returns>The length of the list, or zero if the host has never been resolved successfully.</returns>
+        std::size_t resolve_all( const std::string_view host, family_t family, std::span< char > buffer ) noexcept;
+
+        /// <summary>
+        /// Sets how long resolved addresses are considered valid. Defaults to 5 minutes. The system resolver does not report the TTL of
+        /// the records, so this bounds how long a changed record takes to be picked up.
+        /// </summary>
+        void set_ttl( std::chrono::seconds ttl ) noexcept;
+
+       private:
+        using clock = std::chrono::steady_clock;
+
+        using key_t = std::pair< std::string, family_t >;
+
+        /// <summary>
+        /// Orders the entries by host and family. It is transparent, so that an entry can be found by a host that is only a view.
+        /// </summary>
+        struct key_less
+        {
+            using is_transparent = void;
+
+            using view_t = std::pair< std::string_view, family_t >;
+
+            bool operator()( const view_t& left, const view_t& right ) const noexcept
+            {
+                return left < right;
+            }
+        };
+
+        /// <summary>
+        /// A cached address.
+        /// </summary>
+        struct entry_t
+        {
+            std::vector< std::string > addresses;
+            clock::time_point expires, last_used;
+        };
+
+        explicit resolver() noexcept;
+
+        /// <summary>
+        /// Performs a blocking lookup of every address of a host through the system resolver.
+        /// </summary>
+        static std::optional< std::vector< std::string > > lookup( const std::string& host, family_t family ) noexcept;
+
+        /// <summary>
+        /// Finds the cached entry of a host, or looks it up if there is none, and passes its addresses to the visitor with the lock held.
+        /// </summary>
+        /// <returns>False if the host has never been resolved successfully.</returns>
+        template < typename Visitor >
+        bool visit( const std::string_view host, family_t family, Visitor&& visitor ) noexcept;
+
+        /// <summary>
+        /// The loop of the thread that refreshes entries before they expire.
+        /// </summary>
+        void refresh() noexcept;
+
+        std::mutex mutex;
+        std::condition_variable wakeup;
+
+        std::map< key_t, entry_t, key_less > entries;
+        std::chrono::seconds ttl;
+
+        bool stopping;
+
+        std::once_flag started;
+        std::thread thread;
+    };
+}  // namespace tsar
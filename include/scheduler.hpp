@@ -0,0 +1,236 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "user.hpp"
+
+namespace tsar
+{
+    /// <summary>
+    /// Sends the heartbeats of many user sessions from a small pool of worker threads. Sessions are kept in a hierarchical timer wheel, so
+    /// registering, cancelling and expiring a session are constant-time operations regardless of how many sessions are scheduled.
+    /// </summary>
+    class scheduler final
+    {
+       public:
+        /// <summary>
+        /// Identifies a session registered with the scheduler.
+        /// </summary>
+        using id_t = std::uint64_t;
+
+        /// <summary>
+        /// Invoked on a worker thread when the server rejects a session: it was revoked (`error_code_t::unauthorized_t`), its app is not
+        /// found or paused, or the program hash is not authorized. The session is removed from the scheduler before the callback is invoked.
+        /// Other failures, e.g. timeouts or server errors, are retried with a backoff and do not invoke the callback.
+        /// </summary>
+        using callback_t = std::function< void( id_t id, const error& err ) >;
+
+        /// <summary>
+        /// The configuration of the scheduler.
+        /// </summary>
+        struct options_t
+        {
+            /// <summary>
+            /// The interval between two heartbeats of a session. Should be between 10 and 30 seconds to avoid rate limiting.
+            /// </summary>
+            std::chrono::milliseconds interval{ std::chrono::seconds( 20 ) };
+
+            /// <summary>
+            /// The fraction of the interval by which each heartbeat is randomly moved, so sessions do not fire in synchronized bursts.
+            /// </summary>
+            double jitter{ 0.1 };
+
+            /// <summary>
+            /// The duration of one tick of the timer wheel.
+            /// </summary>
+            std::chrono::milliseconds resolution{ 100 };
+
+            /// <summary>
+            /// The number of worker threads that send heartbeats.
+            /// </summary>
+            std::size_t workers{ 2 };
+
+            /// <summary>
+            /// The maximum number of heartbeats a worker sends in one batch.
+            /// </summary>
+            std::size_t batch_size{ 64 };
+
+            /// <summary>
+            /// The delay before the first retry of a failed heartbeat. It doubles with every failure in a row, up to the interval.
+            /// </summary>
+            std::chrono::milliseconds retry_delay{ std::chrono::seconds( 1 ) };
+        };
+
+        /// <summary>
+        /// Statistics of the scheduler.
+        /// </summary>
+        struct stats_t
+        {
+            /// <summary>
+            /// The number of sessions that are currently registered.
+            /// </summary>
+            std::size_t sessions;
+
+            /// <summary>
+            /// The number of heartbeats that have been fired.
+            /// </summary>
+            std::uint64_t fired;
+
+            /// <summary>
+            /// The average and the largest delay between the time a heartbeat was due and the time a worker sent it, including the time the
+            /// batch waited for a free worker.
+            /// </summary>
+            std::chrono::microseconds average_lag, max_lag;
+        };
+
+        explicit scheduler();
+        explicit scheduler( options_t options );
+        ~scheduler();
+
+        scheduler( const scheduler& ) = delete;
+        scheduler& operator=( const scheduler& ) = delete;
+
+        /// <summary>
+        /// Registers a session. Its first heartbeat is sent at a random point within the first interval.
+        /// </summary>
+        /// <param name="session">The authenticated user.</param>
+        /// <param name="callback">Invoked if the server rejects the session.</param>
+        /// <returns>The ID of the registration.</returns>
+        id_t add( user session, callback_t callback );
+
+        /// <summary>
+        /// Cancels a registration. A heartbeat that is already in flight completes, but its result is discarded.
+        /// </summary>
+        /// <returns>True if the session was registered.</returns>
+        bool remove( id_t id ) noexcept;
+
+        /// <summary>
+        /// Gets the statistics of the scheduler.
+        /// </summary>
+        stats_t stats() const noexcept;
+
+       private:
+        using clock = std::chrono::steady_clock;
+
+        static constexpr std::uint32_t npos = ~0u;
+
+        static constexpr std::size_t level_bits = 6;
+        static constexpr std::size_t slots = 1 << level_bits;
+        static constexpr std::size_t levels = 4;
+
+        enum class state_t : std::uint8_t
+        {
+            free,
+            armed,
+            running,
+            cancelled
+        };
+
+        /// <summary>
+        /// A registration. Armed entries are linked into one slot of the wheel.
+        /// </summary>
+        struct entry_t
+        {
+            std::shared_ptr< const user > session;
+            callback_t callback;
+
+            clock::time_point deadline;
+            std::uint64_t expires;
+
+            std::uint32_t generation, prev, next;
+            std::uint32_t failures;
+            std::uint8_t level, slot;
+            state_t state;
+        };
+
+        /// <summary>
+        /// The loop of the thread that advances the wheel.
+        /// </summary>
+        void tick() noexcept;
+
+        /// <summary>
+        /// The loop of a worker thread.
+        /// </summary>
+        void work() noexcept;
+
+        /// <summary>
+        /// Sends the heartbeats of a batch, re-arms the sessions that are still valid and retries the ones that failed.
+        /// </summary>
+        void fire( const std::vector< id_t >& batch ) noexcept;
+
+        /// <summary>
+        /// Links an entry into the slot that matches its expiry tick. Must be called with the lock held.
+        /// </summary>
+        void link( std::uint32_t index ) noexcept;
+
+        /// <summary>
+        /// Removes an entry from its slot. Must be called with the lock held.
+        /// </summary>
+        void unlink( std::uint32_t index ) noexcept;
+
+        /// <summary>
+        /// Arms an entry to fire after the delay. Must be called with the lock held.
+        /// </summary>
+        void arm( std::uint32_t index, clock::time_point from, clock::duration delay ) noexcept;
+
+        /// <summary>
+        /// The interval, moved by the jitter. Must be called with the lock held.
+        /// </summary>
+        clock::duration jittered_interval() noexcept;
+
+        /// <summary>
+        /// Whether a heartbeat failed because the server rejected the session, rather than a failure that may go away on a retry.
+        /// </summary>
+        static bool is_rejection( const error& err ) noexcept;
+
+        /// <summary>
+        /// Advances the wheel by one tick and collects the entries that expired. Must be called with the lock held.
+        /// </summary>
+        void advance( clock::time_point now, std::vector< id_t >& due ) noexcept;
+
+        /// <summary>
+        /// Returns an entry to the free list. Must be called with the lock held.
+        /// </summary>
+        void release( std::uint32_t index ) noexcept;
+
+        /// <summary>
+        /// Gets the entry of a registration, or null if the registration no longer exists. Must be called with the lock held.
+        /// </summary>
+        entry_t* find( id_t id ) noexcept;
+
+        options_t options;
+
+        mutable std::mutex mutex;
+        std::condition_variable wakeup, ready;
+
+        std::vector< entry_t > entries;
+        std::uint32_t free_list;
+        std::array< std::array< std::uint32_t, slots >, levels > wheel;
+
+        clock::time_point start;
+        std::uint64_t current;
+
+        std::deque< std::vector< id_t > > batches;
+
+        std::minstd_rand random;
+
+        std::size_t sessions;
+        std::uint64_t fired;
+        clock::duration total_lag, max_lag;
+
+        bool stopping;
+
+        std::thread ticker;
+        std::vector< std::thread > workers;
+    };
+}  // namespace tsar
@@ -1,24 +1,14 @@
 #pragma once
 
+#include <chrono>
 #include <optional>
 #include <string_view>
 #include <string>
 #include <iostream>
-#include <fstream>
 #include <vector>
-#include <sstream>
-#include <iomanip>
 #include <stdexcept>
-#include <openssl/sha.h>
 #include <limits.h>
 
-#if defined _WIN32 || defined _WIN64 || defined __CYGWIN__
-#include <windows.h>
-#else
-// Note: This is a temporary solution while the API is in development. Eventually we will support other platforms.
-#error "This code can only be compiled on Windows."
-#endif
-
 
 /// <summary>
 /// System utilities for the TSAR API.
@@ -26,9 +16,10 @@
 namespace tsar::system
 {
     /// <summary>
-    /// Gets the hardware ID of the current system.
+    /// Gets the hardware ID of the current system. On Windows, this is the machine GUID. On Linux, it is derived from the machine ID and
+    /// the DMI identifiers of the board. The ID is read once per process and shared by all callers.
     /// </summary>
-    extern std::optional< std::string > hwid() noexcept;
+    extern const std::optional< std::string >& hwid() noexcept;
 
     /// <summary>
     /// Opens a browser window with the specified URL.
@@ -37,6 +28,60 @@ namespace tsar::system
     /// <returns>True if successful.</returns>
     extern bool open_browser( const std::string_view url ) noexcept;
 
-    extern std::string get_hash() noexcept;
+    /// <summary>
+    /// How the hash of the executable was obtained by the first request that needed it.
+    /// </summary>
+    struct hash_status_t
+    {
+        /// <summary>
+        /// Whether the background computation had already finished.
+        /// </summary>
+        bool ready;
+
+        /// <summary>
+        /// Whether the request used the hash from the on-disk hash cache instead of waiting for the hash to be computed.
+        /// </summary>
+        bool cached;
+
+        /// <summary>
+        /// How long the request had to wait for the hash.
+        /// </summary>
+        std::chrono::microseconds wait;
+    };
+
+    /// <summary>
+    /// Enables the on-disk hash cache, so that the first request of a launch does not wait for a large executable to be hashed. Must be
+    /// called before the first request to have an effect on it. The entries are authenticated with the secret: it must be a value the end
+    /// user cannot read, not one stored next to the cache. The full hash is still computed in the background and replaces the cached one
+    /// as soon as it is ready.
+    /// </summary>
+    /// <param name="path">The cache file, or a directory to create it in.</param>
+    /// <param name="secret">The key of the HMAC that authenticates the entries. The cache stays disabled if it is empty.</param>
+    extern void enable_hash_cache( const std::string_view path, const std::string_view secret ) noexcept;
+
+    /// <summary>
+    /// Starts computing the hash of the executable on a background thread, unless it has already been started. Called when the SDK is
+    /// loaded.
+    /// </summary>
+    extern void precompute_hash() noexcept;
+
+    /// <summary>
+    /// Gets the SHA-256 hash of the executable as a hexadecimal string. The hash is only computed once per process, and waited on if the
+    /// background computation has not finished yet.
+    /// </summary>
+    extern const std::string& get_hash() noexcept;
+
+    /// <summary>
+    /// Hashes a file with SHA-256, the same way the executable is hashed. Meant for measuring the hash on files of other sizes.
+    /// </summary>
+    /// <param name="path">The file.</param>
+    /// <param name="mapped">Whether the file is mapped into memory, or read in chunks like when mapping the executable fails.</param>
+    /// <returns>The hash as a hexadecimal string, or an empty string if the file could not be read.</returns>
+    extern std::string hash_file( const std::string_view path, bool mapped = true ) noexcept;
+
+    /// <summary>
+    /// Gets how the hash of the executable was obtained by the first request that needed it, or nothing if no request has needed it yet.
+    /// </summary>
+    extern std::optional< hash_status_t > hash_status() noexcept;
 
 }  // namespace tsar::system
\ No newline at end of file
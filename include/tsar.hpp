@@ -1,8 +1,19 @@
 #pragma once
 
+#include <array>
+#include <functional>
+#include <future>
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
 
+#include "base64.hpp"
+#include "crypto/der.hpp"
+#include "crypto/key.hpp"
+#include "decode.hpp"
+#include "http/arena.hpp"
+#include "http/pool.hpp"
 #include "ntp/client.hpp"
 
 #include <nlohmann/json.hpp>
@@ -11,6 +22,26 @@ namespace tsar
 {
     class user;
 
+    /// <summary>
+    /// A string literal that can be passed as a template argument, e.g. the app ID and client key of `client::create`.
+    /// </summary>
+    template< std::size_t size >
+    struct fixed_string_t
+    {
+        char value[ size ];
+
+        consteval fixed_string_t( const char ( &text )[ size ] ) noexcept
+        {
+            for ( std::size_t i = 0; i < size; ++i )
+                value[ i ] = text[ i ];
+        }
+
+        constexpr std::string_view view() const noexcept
+        {
+            return { value, size - 1 };
+        }
+    };
+
     /// <summary>
     /// The TSAR client class. This class interacts with the API after it has been initialized.
     /// </summary>
@@ -19,36 +50,184 @@ namespace tsar
         friend class user;
 
         /// <summary>
-        /// The URL of the TSAR API.
+        /// The URL of the TSAR API. Defaults to the `TSAR_API_URL` environment variable if it is set.
         /// </summary>
-        constexpr static auto api_url = "https://tsar.cc/api/client";
+        static std::string api_url;
 
         /// <summary>
         /// The NTP client used to get the current time.
         /// </summary>
         static ntp::client ntp;
 
-        std::string app_id, pub_key, hostname;
+        std::string app_id, hostname;
+
+        /// <summary>
+        /// The public key of the app, which signs the responses to the client's requests.
+        /// </summary>
+        crypto::key pub_key;
+
+        /// <summary>
+        /// The HWID of the system, and the part of the query that identifies the system and the binary in every request.
+        /// </summary>
+        std::string hwid, query;
+
+        /// <summary>
+        /// The pool of cURL handles shared by the client and every user it authenticates.
+        /// </summary>
+        std::shared_ptr< http::pool > pool;
 
         /// <summary>
         /// Creates a new TSAR client with the specified app ID and public key.
         /// </summary>
-        explicit client( const std::string_view app_id, const std::string_view pub_key, const std::string_view hostname );
+        explicit client(
+            const std::string_view app_id,
+            crypto::key pub_key,
+            const std::string_view hostname,
+            const std::string_view hwid,
+            const std::string_view query,
+            std::shared_ptr< http::pool > pool );
+
+        /// <summary>
+        /// Queries the TSAR API at the specified URL and decodes the verified payload of the response. The response buffers are allocated
+        /// from the memory resource of the payload.
+        /// </summary>
+        static result_t< void > api_request(
+            http::pool& pool,
+            const crypto::key& key,
+            const std::string& url,
+            const std::string& hwid,
+            std::pmr::string& payload ) noexcept;
+
+        /// <summary>
+        /// Queries the TSAR API at the specified URL, and decodes the data of the payload into a struct with a `decode::descriptor_t`.
+        /// </summary>
+        template< typename T >
+        static result_t< T > api_call( http::pool& pool, const crypto::key& key, const std::string& url, const std::string& hwid ) noexcept;
+
+        /// <summary>
+        /// Queries the TSAR API at the specified URL without blocking. The callback is invoked on the I/O thread of the engine, with a
+        /// verified payload that is only valid until the callback returns.
+        /// </summary>
+        static void api_call_async(
+            const std::shared_ptr< http::pool >& pool,
+            crypto::key key,
+            std::string url,
+            std::string hwid,
+            std::function< void( result_t< std::string_view >&& ) > callback ) noexcept;
 
         /// <summary>
-        /// Queries the TSAR API with the specified endpoint.
+        /// Builds the URL of a request to the specified endpoint.
         /// </summary>
-        static result_t< nlohmann::json > api_call( const std::string_view key, const std::string_view endpoint ) noexcept;
+        static std::string request_url( const std::string_view endpoint, const std::string_view query );
 
+        /// <summary>
+        /// Validates the response of the TSAR API, and decodes its payload if the signature of the payload is valid.
+        /// </summary>
+        static result_t< void > verify_response(
+            const crypto::key& key,
+            const std::string& hwid,
+            long status_code,
+            http::envelope& response,
+            std::pmr::string& payload ) noexcept;
+
+        /// <summary>
+        /// Decodes the data of a verified payload into a struct with a `decode::descriptor_t`.
+        /// </summary>
         template< typename T >
-        static result_t< T > api_call( const std::string_view key, const std::string_view endpoint ) noexcept;
+        static result_t< T > decode_payload( const std::string_view payload ) noexcept;
+
+        /// <summary>
+        /// Opens the user's browser if the authentication failed, or hands the client's connections to the authenticated user.
+        /// </summary>
+        result_t< user > finish_authentication( result_t< user >&& result, bool open ) const noexcept;
+
+        /// <summary>
+        /// The length of an app ID in UUID format, and of a base64-encoded client key.
+        /// </summary>
+        static constexpr std::size_t app_id_size = 36, client_key_size = 124;
+
+        /// <summary>
+        /// Checks that an app ID is in UUID format.
+        /// </summary>
+        static constexpr bool is_app_id( const std::string_view app_id ) noexcept
+        {
+            if ( app_id.size() != app_id_size )
+                return false;
+
+            for ( std::size_t i = 0; i < app_id.size(); ++i )
+            {
+                const auto c = app_id[ i ];
+
+                if ( i == 8 || i == 13 || i == 18 || i == 23 ? c != '-' : !( ( c >= '0' && c <= '9' ) || ( c >= 'a' && c <= 'f' ) || ( c >= 'A' && c <= 'F' ) ) )
+                    return false;
+            }
+
+            return true;
+        }
 
         /// <summary>
-        /// Verifies the signature of the JSON data using the ECDSA algorithm.
+        /// Decodes a client key into the DER encoding of the public key of the app. Also used in constant expressions, to embed the decoded
+        /// key in the binary.
         /// </summary>
-        static bool verify_signature( const std::string_view key, const std::string_view json, const std::string_view signature ) noexcept;
+        static constexpr std::optional< std::array< char, crypto::der::public_key_size > > decode_client_key( const std::string_view client_key ) noexcept
+        {
+            std::array< char, client_key_size / 4 * 3 > decoded{};
+            const auto size = base64::try_decode_into( client_key, decoded );
+
+            if ( !size || !crypto::der::is_public_key( std::string_view( decoded.data(), *size ) ) )
+                return std::nullopt;
+
+            std::array< char, crypto::der::public_key_size > der{};
+            for ( std::size_t i = 0; i < der.size(); ++i )
+                der[ i ] = decoded[ i ];
+
+            return der;
+        }
+
+        /// <summary>
+        /// Creates a new TSAR client with the decoded public key of the app, and makes the initialization request.
+        /// </summary>
+        static result_t< client > initialize( const std::string_view app_id, const std::string_view der ) noexcept;
 
        public:
+        /// <summary>
+        /// The URL of the live TSAR API.
+        /// </summary>
+        static constexpr auto default_api_url = "https://tsar.cc/api/client";
+
+        /// <summary>
+        /// Overrides the URL of the TSAR API, e.g. to point the SDK at a local stand-in server. Must be called before any request is made.
+        /// </summary>
+        /// <param name="url">The base URL of the API, without a trailing slash: http://127.0.0.1:8080/api/client</param>
+        static void set_api_url( const std::string_view url );
+
+        /// <summary>
+        /// Overrides the NTP servers used to check the system time with a single server. Defaults to the `TSAR_NTP_SERVER` environment
+        /// variable, a comma-separated list in host[:port] format, if it is set, or time.cloudflare.com and time.google.com. Must be called
+        /// before any request is made.
+        /// </summary>
+        static void set_ntp_server( const std::string_view host, std::uint16_t port = 123 );
+
+        /// <summary>
+        /// Adds an NTP server used to check the system time. Every server is queried in parallel, and the time is taken from the response
+        /// with the lowest round-trip delay, so a slow or unreachable server does not delay the check. Must be called before any request is made.
+        /// </summary>
+        static void add_ntp_server( const std::string_view host, std::uint16_t port = 123 );
+
+        /// <summary>
+        /// Changes how often the NTP time is measured again in the background. Between measurements, it is extrapolated with the steady
+        /// clock. Defaults to every 10 minutes.
+        /// </summary>
+        static void set_ntp_refresh_interval( std::chrono::seconds interval );
+
+        /// <summary>
+        /// Changes where the time is checked against. By default, the NTP servers are always queried. With ntp::client::source_t::automatic,
+        /// they are skipped while the kernel reports the system clock as synchronized within the tolerance, e.g. by chrony or
+        /// systemd-timesyncd. That trusts the local clock, which the user of a machine they control can set back, so only opt in on trusted
+        /// machines.
+        /// </summary>
+        static void set_ntp_source( ntp::client::source_t source, std::chrono::milliseconds tolerance = ntp::client::default_kernel_tolerance );
+
         /// <summary>
         /// Creates a new TSAR client with the specified app ID and client key.
         /// </summary>
@@ -56,6 +235,24 @@ namespace tsar
         /// <param name="client_key">The public decryption key for your TSAR app. Should be in base64 format.</param>
         static result_t< client > create( const std::string_view app_id, const std::string_view client_key ) noexcept;
 
+        /// <summary>
+        /// Creates a new TSAR client with an app ID and client key that are checked at compile time. A malformed ID or key fails the build,
+        /// and the key is embedded in the binary already decoded.
+        /// </summary>
+        /// <typeparam name="id">The ID of your TSAR app, in UUID format: 00000000-0000-0000-0000-000000000000</typeparam>
+        /// <typeparam name="key">The public decryption key for your TSAR app, in base64 format.</typeparam>
+        template< fixed_string_t id, fixed_string_t key >
+        static result_t< client > create() noexcept
+        {
+            static_assert( is_app_id( id.view() ), "The app ID must be in UUID format: 00000000-0000-0000-0000-000000000000" );
+            static_assert( key.view().size() == client_key_size, "The client key must be 124 base64 characters long" );
+
+            static constexpr auto der = decode_client_key( key.view() );
+            static_assert( der.has_value(), "The client key must be the base64 encoding of a P-256 public key" );
+
+            return initialize( id.view(), std::string_view( der->data(), der->size() ) );
+        }
+
         /// <summary>
         /// Attemps to authenticate the client with the TSAR API. If the user's HWID is not authorized, the function opens the user's default browser
         /// to prompt a login.
@@ -63,26 +260,72 @@ namespace tsar
         /// <param name="open">Whether to open the user's default browser to prompt a login.</param>
         /// <returns>The user.</returns>
         result_t< user > authenticate( bool open = true ) const noexcept;
+
+        /// <summary>
+        /// Authenticates the client without blocking the calling thread. The callback is invoked on the I/O thread of the engine, so it should
+        /// return quickly.
+        /// </summary>
+        /// <param name="callback">Invoked with the result of the authentication.</param>
+        /// <param name="open">Whether to open the user's default browser to prompt a login.</param>
+        void authenticate_async( std::function< void( result_t< user >&& ) > callback, bool open = true ) const noexcept;
+
+        /// <summary>
+        /// Authenticates the client without blocking the calling thread.
+        /// </summary>
+        /// <param name="open">Whether to open the user's default browser to prompt a login.</param>
+        /// <returns>A future that holds the user once the request completes.</returns>
+        std::future< result_t< user > > authenticate_async( bool open = true ) const;
+
+        /// <summary>
+        /// Gets the connection statistics of the client, including how many requests reused a warm connection.
+        /// </summary>
+        http::pool::stats_t connection_stats() const noexcept;
+
+        /// <summary>
+        /// Sets the maximum size of a response body, for the client and every user it authenticates. Requests with larger responses fail
+        /// with `error_code_t::response_too_large_t`. Defaults to 1 MiB.
+        /// </summary>
+        void set_max_response_size( std::size_t bytes ) const noexcept;
+
+        /// <summary>
+        /// Sets the token bucket of a class of endpoints, for the client and every user it authenticates. Only authentication is limited
+        /// by default, to one request every 3 seconds with bursts of 3.
+        /// </summary>
+        void set_rate_limit( http::governor::endpoint_t endpoint, http::governor::limit_t limit ) const noexcept;
+
+        /// <summary>
+        /// Sets the longest time a request may be held back by the rate limits or by a Retry-After of the server. Requests that would have
+        /// to wait longer fail with `error_code_t::rate_limited_t` without being sent. Defaults to 10 seconds.
+        /// </summary>
+        void set_max_throttle_wait( std::chrono::milliseconds max_wait ) const noexcept;
+
+        /// <summary>
+        /// Gets the throttling statistics of the client, including the total time requests were held back.
+        /// </summary>
+        http::governor::stats_t throttle_stats() const noexcept;
     };
 
     template< typename T >
-    inline result_t< T > client::api_call( const std::string_view key, const std::string_view endpoint ) noexcept
+    inline result_t< T > client::api_call( http::pool& pool, const crypto::key& key, const std::string& url, const std::string& hwid ) noexcept
     {
-        const auto result = api_call( key, endpoint );
+        // The payload is decoded straight into the struct, so only the struct outlives the arena.
+        std::pmr::string payload( http::arena::local().reset() );
 
-        if ( result )
-        {
-            try
-            {
-                return T{ ( *result )[ "data" ] };
-            }
-            catch ( const error& e )
-            {
-                return std::unexpected( e );
-            }
-        }
+        if ( const auto result = api_request( pool, key, url, hwid, payload ); !result )
+            return std::unexpected( result.error() );
+
+        return decode_payload< T >( payload );
+    }
+
+    template< typename T >
+    inline result_t< T > client::decode_payload( const std::string_view payload ) noexcept
+    {
+        T value;
+
+        if ( !decode::decode_payload( payload, value ) )
+            return std::unexpected( error( error_code_t::failed_to_parse_body_t ) );
 
-        return std::unexpected( result.error() );
+        return value;
     }
 
 }  // namespace tsar
@@ -34,12 +34,25 @@ namespace tsar
     /// </summary>
     class user
     {
-        std::string session, session_key;
+        friend class client;
+        friend struct decode::descriptor_t< user >;
 
-        result_t< nlohmann::json > api_query( const std::string_view endpoint ) const noexcept;
+        std::string session;
 
-        template< typename T >
-        result_t< T > api_query( const std::string_view endpoint ) const noexcept;
+        /// <summary>
+        /// The public key of the session, which signs the responses to the user's requests.
+        /// </summary>
+        crypto::key session_key;
+
+        /// <summary>
+        /// The HWID of the system, the query that identifies the session in every request, and the prebuilt URL of its heartbeat.
+        /// </summary>
+        std::string hwid, query, heartbeat_url;
+
+        /// <summary>
+        /// The pool of cURL handles of the client that authenticated the user.
+        /// </summary>
+        std::shared_ptr< http::pool > pool;
 
        public:
         std::string id;
@@ -48,7 +61,8 @@ namespace tsar
         subscription_t subscription;
 
         /// <summary>
-        /// Creates a new user from the specified JSON data. Throws if the JSON data is invalid.
+        /// Creates a new user from the specified JSON data. Throws if the JSON data is invalid. Responses of the API are decoded without
+        /// a DOM, this is only kept for JSON that has already been parsed.
         /// </summary>
         /// <param name="json">The json data.</param>
         explicit user( const nlohmann::json& json );
@@ -62,25 +76,43 @@ namespace tsar
         /// Performs a heartbeat request to the TSAR API for the current session.
         /// </summary>
         result_t< void > heartbeat() const noexcept;
+
+        /// <summary>
+        /// Performs a heartbeat request without blocking the calling thread. The callback is invoked on the I/O thread of the engine, so it
+        /// should return quickly.
+        /// </summary>
+        /// <param name="callback">Invoked with the result of the heartbeat.</param>
+        void heartbeat_async( std::function< void( result_t< void >&& ) > callback ) const noexcept;
+
+        /// <summary>
+        /// Performs a heartbeat request without blocking the calling thread.
+        /// </summary>
+        /// <returns>A future that holds the result once the request completes.</returns>
+        std::future< result_t< void > > heartbeat_async() const;
     };
 
-    template< typename T >
-    inline result_t< T > user::api_query( const std::string_view endpoint ) const noexcept
-    {
-        const auto result = api_query( endpoint );
-
-        if ( result )
-        {
-            try
-            {
-                return T{ *result };
-            }
-            catch ( const error& e )
-            {
-                return std::unexpected( e );
-            }
-        }
-
-        return std::unexpected( result.error() );
-    }
 }  // namespace tsar
+
+namespace tsar::decode
+{
+    template<>
+    struct descriptor_t< subscription_t >
+    {
+        static constexpr auto fields = std::make_tuple(
+            field( "id", &subscription_t::id ),
+            field( "expires", &subscription_t::expires ),
+            field( "tier", &subscription_t::tier ) );
+    };
+
+    template<>
+    struct descriptor_t< user >
+    {
+        static constexpr auto fields = std::make_tuple(
+            field( "id", &user::id ),
+            field( "name", &user::name ),
+            field( "avatar", &user::avatar ),
+            field( "subscription", &user::subscription ),
+            field( "session", &user::session ),
+            field( "session_key", &user::session_key ) );
+    };
+}  // namespace tsar::decode
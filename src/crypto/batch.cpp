@@ -0,0 +1,151 @@
+#include "crypto/batch.hpp"
+
+#include <algorithm>
+
+namespace tsar::crypto
+{
+    batch& batch::get() noexcept
+    {
+        static batch instance( std::max( std::thread::hardware_concurrency(), 1u ) - 1 );
+        return instance;
+    }
+
+    batch::batch( std::size_t workers ) noexcept : worker_count( workers ), stopping( false )
+    {
+    }
+
+    batch::~batch()
+    {
+        {
+            std::lock_guard lock( mutex );
+            stopping = true;
+        }
+
+        ready.notify_all();
+
+        for ( auto& worker : workers )
+            worker.join();
+    }
+
+    bool batch::drain( job_t& job ) noexcept
+    {
+        const auto size = job.items.size();
+        bool last = false;
+
+        for ( ;; )
+        {
+            const auto index = job.next.fetch_add( 1, std::memory_order_relaxed );
+
+            if ( index >= size )
+                return last;
+
+            const auto& item = job.items[ index ];
+            job.results[ index ] = item.signer && item.signer->verify( item.message, item.signature );
+
+            if ( job.done.fetch_add( 1, std::memory_order_acq_rel ) + 1 == size )
+                last = true;
+        }
+    }
+
+    bool batch::start() noexcept
+    {
+        if ( !workers.empty() )
+            return true;
+
+        try
+        {
+            for ( std::size_t i = 0; i < worker_count; ++i )
+                workers.emplace_back( &batch::work, this );
+        }
+        catch ( const std::exception& )
+        {
+            // The workers that did start take part in the batches, the others are made up for by the caller.
+        }
+
+        return !workers.empty();
+    }
+
+    void batch::verify( std::span< const item_t > items, std::span< bool > results ) noexcept
+    {
+        items = items.first( std::min( items.size(), results.size() ) );
+
+        std::shared_ptr< job_t > job;
+
+        // A single item is not worth waking up a worker for.
+        if ( items.size() > 1 && worker_count > 0 )
+        {
+            try
+            {
+                job = std::make_shared< job_t >();
+                job->items = items;
+                job->results = results;
+
+                std::lock_guard lock( mutex );
+
+                if ( start() )
+                    jobs.push_back( job );
+                else
+                    job.reset();
+            }
+            catch ( const std::exception& )
+            {
+                job.reset();
+            }
+        }
+
+        if ( !job )
+        {
+            for ( std::size_t i = 0; i < items.size(); ++i )
+                results[ i ] = items[ i ].signer && items[ i ].signer->verify( items[ i ].message, items[ i ].signature );
+
+            return;
+        }
+
+        ready.notify_all();
+
+        // The caller verifies items as well, so the batch completes even while every worker is busy with another one.
+        drain( *job );
+
+        std::unique_lock lock( mutex );
+        finished.wait( lock, [ &job, &items ] { return job->done.load( std::memory_order_acquire ) == items.size(); } );
+
+        std::erase( jobs, job );
+    }
+
+    std::vector< bool > batch::verify( std::span< const item_t > items )
+    {
+        const auto results = std::make_unique< bool[] >( items.size() );
+        verify( items, std::span( results.get(), items.size() ) );
+
+        return std::vector< bool >( results.get(), results.get() + items.size() );
+    }
+
+    void batch::work() noexcept
+    {
+        std::unique_lock lock( mutex );
+
+        while ( true )
+        {
+            ready.wait( lock, [ this ] { return stopping || !jobs.empty(); } );
+
+            if ( stopping )
+                return;
+
+            auto job = jobs.front();
+
+            // Every item of the job has been claimed, its caller takes it from here.
+            if ( job->next.load( std::memory_order_relaxed ) >= job->items.size() )
+            {
+                jobs.pop_front();
+                continue;
+            }
+
+            lock.unlock();
+            const auto last = drain( *job );
+            lock.lock();
+
+            if ( last )
+                finished.notify_all();
+        }
+    }
+}  // namespace tsar::crypto
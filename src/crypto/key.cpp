@@ -0,0 +1,173 @@
+#include "crypto/key.hpp"
+
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "crypto/der.hpp"
+
+namespace tsar::crypto
+{
+    namespace
+    {
+        template< auto free >
+        struct deleter_t
+        {
+            template< typename T >
+            void operator()( T* object ) const noexcept
+            {
+                free( object );
+            }
+        };
+
+        using md_context_t = std::unique_ptr< EVP_MD_CTX, deleter_t< EVP_MD_CTX_free > >;
+        using pkey_context_t = std::unique_ptr< EVP_PKEY_CTX, deleter_t< EVP_PKEY_CTX_free > >;
+
+        /// <summary>
+        /// The digest context of a thread. Digests do not depend on the key, so one context serves every key.
+        /// </summary>
+        struct contexts_t
+        {
+            md_context_t digest{ EVP_MD_CTX_new() };
+        };
+
+        contexts_t& local_contexts() noexcept
+        {
+            thread_local contexts_t contexts;
+            return contexts;
+        }
+
+        /// <summary>
+        /// Creates a verification context of a key, set up for SHA-256 ECDSA signatures.
+        /// </summary>
+        pkey_context_t new_verifier( EVP_PKEY* pkey ) noexcept
+        {
+            pkey_context_t verifier( EVP_PKEY_CTX_new( pkey, nullptr ) );
+
+            if ( !verifier || EVP_PKEY_verify_init( verifier.get() ) <= 0 || EVP_PKEY_CTX_set_signature_md( verifier.get(), EVP_sha256() ) <= 0 )
+                return nullptr;
+
+            return verifier;
+        }
+    }  // namespace
+
+    /// <summary>
+    /// The verification contexts of a key that are not in use. A context is taken by a verification and put back once it is done, so the
+    /// contexts are only set up once per key and thread that verifies concurrently, regardless of how many keys are alive.
+    /// </summary>
+    struct key::verifiers_t
+    {
+        /// <summary>
+        /// The number of idle contexts kept per key, which bounds the memory of a key that was verified by many threads at once.
+        /// </summary>
+        static constexpr std::size_t max_idle = 8;
+
+        std::mutex mutex;
+        std::vector< pkey_context_t > idle;
+    };
+
+    std::optional< key > key::parse( const std::string_view der ) noexcept
+    {
+        auto data = reinterpret_cast< const std::uint8_t* >( der.data() );
+
+        const auto pkey = d2i_PUBKEY( nullptr, &data, static_cast< long >( der.size() ) );
+
+        if ( !pkey )
+            return std::nullopt;
+
+        key parsed( pkey );
+
+        if ( !parsed )
+            return std::nullopt;
+
+        return parsed;
+    }
+
+    key::key( void* pkey ) noexcept
+    {
+        try
+        {
+            this->pkey = std::shared_ptr< void >( pkey, []( void* pkey ) { EVP_PKEY_free( static_cast< EVP_PKEY* >( pkey ) ); } );
+
+            // Reserving every slot up front means putting a context back never allocates.
+            auto verifiers = std::make_shared< verifiers_t >();
+            verifiers->idle.reserve( verifiers_t::max_idle );
+            this->verifiers = std::move( verifiers );
+        }
+        catch ( const std::exception& )
+        {
+            // The deleter has already freed the key, or the key verifies without reusing its contexts.
+        }
+    }
+
+    key::operator bool() const noexcept
+    {
+        return pkey != nullptr;
+    }
+
+    void* key::get() const noexcept
+    {
+        return pkey.get();
+    }
+
+    bool key::verify( const std::string_view message, const std::string_view signature ) const noexcept
+    {
+        if ( !pkey )
+            return false;
+
+        // The raw signature is encoded as DER on the stack, without going through big numbers.
+        std::uint8_t der_sig[ der::max_signature_size ];
+        const auto der_len = der::encode_signature( signature, der_sig );
+
+        if ( !der_len )
+            return false;
+
+        auto& contexts = local_contexts();
+
+        if ( !contexts.digest )
+            return false;
+
+        pkey_context_t verifier;
+
+        if ( verifiers )
+        {
+            std::lock_guard lock( verifiers->mutex );
+
+            if ( !verifiers->idle.empty() )
+            {
+                verifier = std::move( verifiers->idle.back() );
+                verifiers->idle.pop_back();
+            }
+        }
+
+        if ( !verifier )
+            verifier = new_verifier( static_cast< EVP_PKEY* >( pkey.get() ) );
+
+        if ( !verifier )
+            return false;
+
+        // The message is hashed separately, so that the verification context only does the ECDSA math and never has to be set up again.
+        unsigned char digest[ EVP_MAX_MD_SIZE ];
+        unsigned int digest_size = 0;
+
+        if ( !EVP_DigestInit_ex( contexts.digest.get(), EVP_sha256(), nullptr ) ||
+             !EVP_DigestUpdate( contexts.digest.get(), message.data(), message.size() ) ||
+             !EVP_DigestFinal_ex( contexts.digest.get(), digest, &digest_size ) )
+            return false;
+
+        const auto verified = EVP_PKEY_verify( verifier.get(), der_sig, der_len, digest, digest_size ) == 1;
+
+        if ( verifiers )
+        {
+            std::lock_guard lock( verifiers->mutex );
+
+            if ( verifiers->idle.size() < verifiers_t::max_idle )
+                verifiers->idle.push_back( std::move( verifier ) );
+        }
+
+        return verified;
+    }
+}  // namespace tsar::crypto
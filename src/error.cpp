@@ -1,5 +1,7 @@
 #include "error.hpp"
 
+#include <cstring>
+
 namespace tsar
 {
     error::error( std::error_code code ) noexcept : std::system_error( code )
@@ -64,6 +66,7 @@ namespace tsar
             case error_code_t::old_response_t: return "Response is old.";
             case error_code_t::invalid_signature_t: return "Signature is not authentic.";
             case error_code_t::hash_unauthorized_t: return "The program hash is not authorized.";
+            case error_code_t::response_too_large_t: return "The response body exceeded the maximum response size.";
 
             case error_code_t::unexpected_error_t:
             default: return "An unexpected error occurred.";
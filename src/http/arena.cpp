@@ -0,0 +1,21 @@
+#include "http/arena.hpp"
+
+namespace tsar::http
+{
+    arena& arena::local() noexcept
+    {
+        thread_local arena instance;
+        return instance;
+    }
+
+    arena::arena() noexcept : resource( buffer, sizeof( buffer ), std::pmr::new_delete_resource() )
+    {
+    }
+
+    std::pmr::memory_resource* arena::reset() noexcept
+    {
+        // Frees whatever spilled over to the heap, and starts allocating from the inline buffer again.
+        resource.release();
+        return &resource;
+    }
+}  // namespace tsar::http
@@ -0,0 +1,208 @@
+#include "http/engine.hpp"
+
+#include <curl/curl.h>
+
+#include <algorithm>
+
+namespace tsar::http
+{
+    engine& engine::get() noexcept
+    {
+        static engine instance;
+        return instance;
+    }
+
+    engine::engine() noexcept : multi( nullptr ), count( 0 ), stopping( false )
+    {
+        // Initializing cURL before the multi handle guarantees it is cleaned up only after the engine has been destroyed.
+        if ( !global_init() )
+            return;
+
+        multi = curl_multi_init();
+
+        if ( multi )
+            curl_multi_setopt( multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX );
+    }
+
+    engine::~engine()
+    {
+        stopping = true;
+
+        if ( multi )
+            curl_multi_wakeup( multi );
+
+        if ( thread.joinable() )
+            thread.join();
+
+        if ( multi )
+            curl_multi_cleanup( multi );
+    }
+
+    bool engine::submit( std::shared_ptr< http::pool > pool, std::string url, callback_t callback, std::chrono::steady_clock::duration delay ) noexcept
+    {
+        if ( !multi || !pool || stopping )
+            return false;
+
+        try
+        {
+            auto handle = pool->acquire();
+
+            if ( !handle )
+                return false;
+
+            const auto max_size = pool->max_response_size();
+
+            auto transfer = std::make_unique< transfer_t >(
+                std::move( pool ), std::move( handle ), std::move( url ), envelope( max_size ), std::move( callback ), std::chrono::steady_clock::now() + delay );
+
+            std::call_once( started, [ this ] { thread = std::thread( &engine::run, this ); } );
+
+            {
+                std::lock_guard lock( mutex );
+                pending.push_back( std::move( transfer ) );
+            }
+
+            count.fetch_add( 1, std::memory_order_relaxed );
+        }
+        catch ( const std::exception& )
+        {
+            return false;
+        }
+
+        curl_multi_wakeup( multi );
+        return true;
+    }
+
+    std::size_t engine::in_flight() const noexcept
+    {
+        return count.load( std::memory_order_relaxed );
+    }
+
+    void engine::run() noexcept
+    {
+        while ( !stopping )
+        {
+            const auto timeout = start_pending();
+
+            int running = 0;
+            curl_multi_perform( multi, &running );
+
+            int queued = 0;
+            while ( const auto message = curl_multi_info_read( multi, &queued ) )
+            {
+                if ( message->msg != CURLMSG_DONE )
+                    continue;
+
+                long status_code = 0;
+                if ( message->data.result == CURLE_OK )
+                    curl_easy_getinfo( message->easy_handle, CURLINFO_RESPONSE_CODE, &status_code );
+
+                complete( message->easy_handle, status_code );
+            }
+
+            // Sleeps until a socket is ready, a timeout of cURL expires, a delayed request is due or a new request is submitted.
+            curl_multi_poll( multi, nullptr, 0, timeout, nullptr );
+        }
+
+        // Fail whatever is still in flight, so that no future is left without a value.
+        start_pending( true );
+
+        while ( !active.empty() )
+            complete( active.begin()->first, 0 );
+    }
+
+    int engine::start_pending( bool all ) noexcept
+    {
+        std::vector< std::unique_ptr< transfer_t > > queued;
+        auto timeout = std::chrono::milliseconds( 1000 );
+
+        {
+            std::lock_guard lock( mutex );
+
+            if ( all )
+                queued.swap( pending );
+            else
+            {
+                // Delayed requests stay queued until they are due. Moving them never throws, and the vectors only shrink.
+                const auto now = std::chrono::steady_clock::now();
+                const auto due = std::stable_partition( pending.begin(), pending.end(), [ now ]( const auto& transfer ) { return transfer->not_before > now; } );
+
+                for ( auto it = pending.begin(); it != due; ++it )
+                    timeout = std::min( timeout, std::chrono::ceil< std::chrono::milliseconds >( ( *it )->not_before - now ) );
+
+                try
+                {
+                    queued.assign( std::make_move_iterator( due ), std::make_move_iterator( pending.end() ) );
+                    pending.erase( due, pending.end() );
+                }
+                catch ( const std::exception& )
+                {
+                    // Retried on the next iteration of the loop.
+                    return 0;
+                }
+            }
+        }
+
+        for ( auto& transfer : queued )
+        {
+            const auto curl = transfer->handle.handle();
+
+            transfer->handle.set_url( transfer->url );
+            transfer->body.attach( curl );
+
+            // Prefer HTTP/2 over TLS, and wait for an existing connection to become available for multiplexing rather than opening a new one.
+            curl_easy_setopt( curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS );
+            curl_easy_setopt( curl, CURLOPT_PIPEWAIT, 1L );
+
+            try
+            {
+                active.try_emplace( curl, std::move( transfer ) );
+            }
+            catch ( const std::exception& )
+            {
+                // try_emplace leaves the transfer alone when it throws, so the request fails as if it never got a response.
+                transfer->pool->record( transfer->handle, false );
+                count.fetch_sub( 1, std::memory_order_relaxed );
+
+                try
+                {
+                    transfer->callback( 0, transfer->body );
+                }
+                catch ( const std::exception& )
+                {
+                }
+
+                continue;
+            }
+
+            if ( curl_multi_add_handle( multi, curl ) != CURLM_OK )
+                complete( curl, 0 );
+        }
+
+        return static_cast< int >( timeout.count() );
+    }
+
+    void engine::complete( void* curl, long status_code ) noexcept
+    {
+        const auto it = active.find( curl );
+
+        if ( it == active.end() )
+            return;
+
+        const auto transfer = std::move( it->second );
+        active.erase( it );
+
+        curl_multi_remove_handle( multi, curl );
+
+        transfer->pool->record( transfer->handle, status_code != 0 );
+        count.fetch_sub( 1, std::memory_order_relaxed );
+
+        try
+        {
+            transfer->callback( status_code, transfer->body );
+        }
+        catch ( const std::exception& )
+        {
+        }
+    }
+}  // namespace tsar::http
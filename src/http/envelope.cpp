@@ -0,0 +1,512 @@
+#include "http/envelope.hpp"
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <ctime>
+
+namespace tsar::http
+{
+    static bool is_whitespace( char c ) noexcept
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    static size_t write_callback( char* ptr, size_t size, size_t nmemb, void* user )
+    {
+        // Returning less than the size of the chunk makes cURL abort the transfer.
+        return static_cast< envelope* >( user )->feed( { ptr, size * nmemb } ) ? size * nmemb : 0;
+    }
+
+    /// <summary>
+    /// Gets the trimmed value of a header line if it has the specified lowercase name, including the colon.
+    /// </summary>
+    static std::optional< std::string_view > header_value( const std::string_view header, const std::string_view name ) noexcept
+    {
+        if ( header.size() <= name.size() ||
+             !std::equal( name.begin(), name.end(), header.begin(), []( char a, char b ) { return a == std::tolower( static_cast< unsigned char >( b ) ); } ) )
+            return std::nullopt;
+
+        auto value = header.substr( name.size() );
+        value.remove_prefix( std::min( value.find_first_not_of( " \t" ), value.size() ) );
+        value.remove_suffix( value.size() - std::min( value.find_last_not_of( " \t\r\n" ) + 1, value.size() ) );
+
+        return value;
+    }
+
+    static size_t header_callback( char* ptr, size_t size, size_t nmemb, void* user )
+    {
+        const std::string_view header( ptr, size * nmemb );
+        const auto body = static_cast< envelope* >( user );
+
+        if ( const auto value = header_value( header, "content-length:" ) )
+        {
+            std::size_t length = 0;
+            if ( std::from_chars( value->data(), value->data() + value->size(), length ).ec == std::errc{} )
+                body->reserve( length );
+        }
+        else if ( const auto value = header_value( header, "retry-after:" ) )
+        {
+            // The delay is either a number of seconds or an HTTP date.
+            std::int64_t seconds = 0;
+
+            if ( std::from_chars( value->data(), value->data() + value->size(), seconds ).ec != std::errc{} )
+            {
+                const std::string date( *value );
+                const auto time = curl_getdate( date.c_str(), nullptr );
+
+                if ( time < 0 )
+                    return size * nmemb;
+
+                seconds = time - std::time( nullptr );
+            }
+
+            body->set_retry_after( std::chrono::seconds( std::max< std::int64_t >( seconds, 0 ) ) );
+        }
+
+        return size * nmemb;
+    }
+
+    envelope::envelope( std::size_t max_size, std::pmr::memory_resource* resource ) noexcept
+        : data_field( resource ),
+          signature_field( resource ),
+          data_set( false ),
+          signature_set( false ),
+          data_valid( false ),
+          max_size( max_size ),
+          received( 0 ),
+          state( state_t::parsing ),
+          position( position_t::before_object ),
+          field( field_t::none ),
+          key{},
+          key_size( 0 ),
+          depth( 0 ),
+          in_string( false ),
+          escaped( false ),
+          code_point( 0 ),
+          digits( 0 )
+    {
+    }
+
+    void envelope::attach( void* curl ) noexcept
+    {
+        curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, write_callback );
+        curl_easy_setopt( curl, CURLOPT_WRITEDATA, this );
+        curl_easy_setopt( curl, CURLOPT_HEADERFUNCTION, header_callback );
+        curl_easy_setopt( curl, CURLOPT_HEADERDATA, this );
+    }
+
+    void envelope::reserve( std::size_t content_length ) noexcept
+    {
+        if ( content_length > max_size )
+            return;
+
+        try
+        {
+            // The payload makes up almost all of the body and is stored decoded, the signature is a fixed-size P-256 signature.
+            data_field.reserve( content_length / 4 * 3 );
+            signature_field.reserve( 128 );
+        }
+        catch ( const std::exception& )
+        {
+        }
+    }
+
+    bool envelope::feed( const std::string_view chunk ) noexcept
+    {
+        received += chunk.size();
+
+        if ( received > max_size )
+        {
+            state = state_t::too_large;
+            return false;
+        }
+
+        // A malformed body is still received completely, so that the status code of the response is not lost.
+        if ( state == state_t::malformed )
+            return true;
+
+        try
+        {
+            std::size_t i = 0;
+
+            while ( i < chunk.size() && state != state_t::malformed )
+            {
+                const auto c = chunk[ i ];
+
+                switch ( position )
+                {
+                    case position_t::before_object:
+                    {
+                        if ( c == '{' )
+                            position = position_t::before_key;
+                        else if ( !is_whitespace( c ) )
+                            state = state_t::malformed;
+
+                        ++i;
+                        break;
+                    }
+                    case position_t::before_key:
+                    {
+                        if ( c == '"' )
+                        {
+                            key_size = 0;
+                            position = position_t::in_key;
+                        }
+                        else if ( c == '}' && key_size == 0 )
+                        {
+                            // Only an empty object may be closed right after its opening brace.
+                            position = position_t::after_object;
+                            state = state_t::complete;
+                        }
+                        else if ( !is_whitespace( c ) )
+                            state = state_t::malformed;
+
+                        ++i;
+                        break;
+                    }
+                    case position_t::in_key:
+                    {
+                        if ( c == '"' )
+                            position = position_t::before_colon;
+                        else if ( c == '\\' )
+                            position = position_t::key_escape;
+                        else if ( key_size < sizeof( key ) )
+                            key[ key_size++ ] = c;
+                        else
+                            key_size = sizeof( key ) + 1;
+
+                        ++i;
+                        break;
+                    }
+                    case position_t::key_escape:
+                    {
+                        // None of the captured keys contain escapes, so an escaped key can only be an unknown one.
+                        key_size = sizeof( key ) + 1;
+                        position = position_t::in_key;
+                        ++i;
+                        break;
+                    }
+                    case position_t::before_colon:
+                    {
+                        if ( c == ':' )
+                            position = position_t::before_value;
+                        else if ( !is_whitespace( c ) )
+                            state = state_t::malformed;
+
+                        ++i;
+                        break;
+                    }
+                    case position_t::before_value:
+                    {
+                        if ( is_whitespace( c ) )
+                        {
+                            ++i;
+                            break;
+                        }
+
+                        if ( c == ',' || c == '}' )
+                        {
+                            state = state_t::malformed;
+                            break;
+                        }
+
+                        const std::string_view name( key, std::min( key_size, sizeof( key ) ) );
+
+                        if ( key_size <= sizeof( key ) && name == "data" )
+                            field = field_t::data;
+                        else if ( key_size <= sizeof( key ) && name == "signature" )
+                            field = field_t::signature;
+                        else
+                            field = field_t::none;
+
+                        // Like a DOM, a repeated key replaces the previous value, and a value that is not a string does not count.
+                        if ( field == field_t::data )
+                            data_set = false;
+                        else if ( field == field_t::signature )
+                            signature_set = false;
+
+                        if ( field != field_t::none && c == '"' )
+                        {
+                            if ( field == field_t::data )
+                            {
+                                data_field.clear();
+                                data_decoder.reset();
+                            }
+                            else
+                                signature_field.clear();
+
+                            position = position_t::in_field;
+                            ++i;
+                            break;
+                        }
+
+                        depth = 0;
+                        in_string = escaped = false;
+                        position = position_t::in_skipped;
+                        break;
+                    }
+                    case position_t::in_field:
+                    {
+                        i += capture( chunk.substr( i ) );
+                        break;
+                    }
+                    case position_t::field_escape:
+                    {
+                        switch ( c )
+                        {
+                            case '"':
+                            case '\\':
+                            case '/': append( static_cast< std::uint8_t >( c ) ); break;
+                            case 'b': append( '\b' ); break;
+                            case 'f': append( '\f' ); break;
+                            case 'n': append( '\n' ); break;
+                            case 'r': append( '\r' ); break;
+                            case 't': append( '\t' ); break;
+                            case 'u':
+                            {
+                                code_point = 0;
+                                digits = 0;
+                                position = position_t::field_unicode;
+                                break;
+                            }
+                            default: state = state_t::malformed; break;
+                        }
+
+                        if ( position == position_t::field_escape )
+                            position = position_t::in_field;
+
+                        ++i;
+                        break;
+                    }
+                    case position_t::field_unicode:
+                    {
+                        std::uint32_t digit = 0;
+
+                        if ( c >= '0' && c <= '9' )
+                            digit = c - '0';
+                        else if ( c >= 'a' && c <= 'f' )
+                            digit = c - 'a' + 10;
+                        else if ( c >= 'A' && c <= 'F' )
+                            digit = c - 'A' + 10;
+                        else
+                        {
+                            state = state_t::malformed;
+                            break;
+                        }
+
+                        code_point = code_point << 4 | digit;
+
+                        if ( ++digits == 4 )
+                        {
+                            append( code_point );
+                            position = position_t::in_field;
+                        }
+
+                        ++i;
+                        break;
+                    }
+                    case position_t::in_skipped:
+                    {
+                        i += skip( chunk.substr( i ) );
+                        break;
+                    }
+                    case position_t::after_value:
+                    {
+                        if ( c == ',' )
+                        {
+                            // A comma has to be followed by another key, so the object may not be closed right away.
+                            key_size = 1;
+                            position = position_t::before_key;
+                        }
+                        else if ( c == '}' )
+                        {
+                            position = position_t::after_object;
+                            state = state_t::complete;
+                        }
+                        else if ( !is_whitespace( c ) )
+                            state = state_t::malformed;
+
+                        ++i;
+                        break;
+                    }
+                    case position_t::after_object:
+                    {
+                        if ( !is_whitespace( c ) )
+                            state = state_t::malformed;
+
+                        ++i;
+                        break;
+                    }
+                }
+            }
+        }
+        catch ( const std::exception& )
+        {
+            state = state_t::malformed;
+        }
+
+        return true;
+    }
+
+    envelope::state_t envelope::finish() const noexcept
+    {
+        return state == state_t::parsing ? state_t::malformed : state;
+    }
+
+    std::pmr::string& envelope::data() noexcept
+    {
+        return data_field;
+    }
+
+    std::pmr::string& envelope::signature() noexcept
+    {
+        return signature_field;
+    }
+
+    bool envelope::has_data() const noexcept
+    {
+        return data_set;
+    }
+
+    bool envelope::has_signature() const noexcept
+    {
+        return signature_set;
+    }
+
+    bool envelope::data_decoded() const noexcept
+    {
+        return data_valid;
+    }
+
+    void envelope::set_retry_after( std::chrono::seconds delay ) noexcept
+    {
+        retry_after_header = delay;
+    }
+
+    std::optional< std::chrono::seconds > envelope::retry_after() const noexcept
+    {
+        return retry_after_header;
+    }
+
+    std::size_t envelope::skip( const std::string_view chunk ) noexcept
+    {
+        for ( std::size_t j = 0; j < chunk.size(); ++j )
+        {
+            const auto c = chunk[ j ];
+
+            if ( in_string )
+            {
+                if ( escaped )
+                    escaped = false;
+                else if ( c == '\\' )
+                    escaped = true;
+                else if ( c == '"' )
+                {
+                    in_string = false;
+
+                    if ( depth == 0 )
+                    {
+                        position = position_t::after_value;
+                        return j + 1;
+                    }
+                }
+
+                continue;
+            }
+
+            if ( c == '"' )
+                in_string = true;
+            else if ( c == '{' || c == '[' )
+                ++depth;
+            else if ( c == '}' || c == ']' )
+            {
+                // A closing brace at the top level ends a scalar and belongs to the enclosing object.
+                if ( depth == 0 )
+                {
+                    position = position_t::after_value;
+                    return j;
+                }
+
+                if ( --depth == 0 )
+                {
+                    position = position_t::after_value;
+                    return j + 1;
+                }
+            }
+            else if ( depth == 0 && ( c == ',' || is_whitespace( c ) ) )
+            {
+                position = position_t::after_value;
+                return j;
+            }
+        }
+
+        return chunk.size();
+    }
+
+    std::size_t envelope::capture( const std::string_view chunk )
+    {
+        // Copy the run of plain characters up to the next quote or escape in one go.
+        const auto end = std::find_if( chunk.begin(), chunk.end(), []( char c ) { return c == '"' || c == '\\' || static_cast< std::uint8_t >( c ) < 0x20; } );
+        const auto length = static_cast< std::size_t >( end - chunk.begin() );
+
+        write( chunk.substr( 0, length ) );
+
+        if ( end == chunk.end() )
+            return length;
+
+        if ( *end == '"' )
+        {
+            if ( field == field_t::data )
+            {
+                data_set = true;
+                data_valid = data_decoder.finish().has_value();
+            }
+            else
+                signature_set = true;
+
+            position = position_t::after_value;
+        }
+        else if ( *end == '\\' )
+            position = position_t::field_escape;
+        else
+            state = state_t::malformed;
+
+        return length + 1;
+    }
+
+    void envelope::append( std::uint32_t code_point )
+    {
+        char encoded[ 3 ];
+        std::size_t size = 0;
+
+        // Encode the code point as UTF-8.
+        if ( code_point < 0x80 )
+            encoded[ size++ ] = static_cast< char >( code_point );
+        else if ( code_point < 0x800 )
+        {
+            encoded[ size++ ] = static_cast< char >( 0xC0 | code_point >> 6 );
+            encoded[ size++ ] = static_cast< char >( 0x80 | ( code_point & 0x3F ) );
+        }
+        else
+        {
+            encoded[ size++ ] = static_cast< char >( 0xE0 | code_point >> 12 );
+            encoded[ size++ ] = static_cast< char >( 0x80 | ( ( code_point >> 6 ) & 0x3F ) );
+            encoded[ size++ ] = static_cast< char >( 0x80 | ( code_point & 0x3F ) );
+        }
+
+        write( { encoded, size } );
+    }
+
+    void envelope::write( const std::string_view text )
+    {
+        // A decoding error is kept by the decoder and reported when the field ends.
+        if ( field == field_t::data )
+            ( void )data_decoder.feed( text, [ this ]( const std::string_view bytes ) { data_field.append( bytes ); } );
+        else
+            signature_field.append( text );
+    }
+}  // namespace tsar::http
@@ -0,0 +1,131 @@
+#include "http/governor.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tsar::http
+{
+    governor::governor() noexcept
+        : buckets{},
+          max_wait( std::chrono::seconds( 10 ) ),
+          random( std::random_device{}() ),
+          throttled( 0 ),
+          rejected( 0 ),
+          throttled_time( 0 )
+    {
+        const auto now = clock::now();
+
+        for ( auto& bucket : buckets )
+        {
+            bucket.limit = { 0.0, 0.0 };
+            bucket.updated = now;
+        }
+
+        // Authentication is polled while the user logs in through the browser, which should not happen more than once every 3 seconds.
+        set_limit( endpoint_t::authenticate, { 1.0 / 3.0, 3.0 } );
+    }
+
+    governor::endpoint_t governor::classify( const std::string_view endpoint ) noexcept
+    {
+        const auto name = endpoint.substr( 0, endpoint.find( '?' ) );
+
+        if ( name == "heartbeat" )
+            return endpoint_t::heartbeat;
+
+        if ( name == "authenticate" )
+            return endpoint_t::authenticate;
+
+        if ( name == "initialize" )
+            return endpoint_t::initialize;
+
+        return endpoint_t::other;
+    }
+
+    void governor::set_limit( endpoint_t endpoint, limit_t limit ) noexcept
+    {
+        std::lock_guard lock( mutex );
+
+        auto& bucket = buckets[ static_cast< std::size_t >( endpoint ) ];
+
+        bucket.limit = { std::max( limit.rate, 0.0 ), std::max( limit.burst, 1.0 ) };
+        bucket.tokens = bucket.limit.burst;
+        bucket.updated = clock::now();
+    }
+
+    void governor::set_max_wait( std::chrono::milliseconds max_wait ) noexcept
+    {
+        std::lock_guard lock( mutex );
+        this->max_wait = std::max( max_wait, std::chrono::milliseconds( 0 ) );
+    }
+
+    std::optional< governor::clock::duration > governor::reserve( endpoint_t endpoint ) noexcept
+    {
+        std::lock_guard lock( mutex );
+
+        auto& bucket = buckets[ static_cast< std::size_t >( endpoint ) ];
+        const auto now = clock::now();
+
+        auto wait = std::max( bucket.blocked_until - now, clock::duration::zero() );
+
+        if ( bucket.limit.rate > 0.0 )
+        {
+            // Refill the bucket for the time that passed. Tokens may go negative, which reserves the slots of requests that are waiting.
+            const auto elapsed = std::chrono::duration< double >( now - bucket.updated ).count();
+
+            bucket.tokens = std::min( bucket.limit.burst, bucket.tokens + elapsed * bucket.limit.rate );
+            bucket.updated = now;
+
+            if ( bucket.tokens < 1.0 )
+                wait = std::max( wait, std::chrono::duration_cast< clock::duration >( std::chrono::duration< double >( ( 1.0 - bucket.tokens ) / bucket.limit.rate ) ) );
+        }
+
+        if ( wait > max_wait )
+        {
+            ++rejected;
+            return std::nullopt;
+        }
+
+        if ( bucket.limit.rate > 0.0 )
+            bucket.tokens -= 1.0;
+
+        if ( wait > clock::duration::zero() )
+        {
+            ++throttled;
+            throttled_time += wait;
+        }
+
+        return wait;
+    }
+
+    void governor::record( endpoint_t endpoint, long status_code, std::optional< std::chrono::seconds > retry_after ) noexcept
+    {
+        std::lock_guard lock( mutex );
+
+        auto& bucket = buckets[ static_cast< std::size_t >( endpoint ) ];
+
+        if ( status_code != 429 && status_code != 503 )
+        {
+            if ( status_code >= 200 && status_code < 300 )
+                bucket.failures = 0;
+
+            return;
+        }
+
+        // The server knows how long it is overloaded, so its Retry-After is honored as given. Without one, the delay is an exponential
+        // backoff from 1 second up to a minute, with full jitter over its upper half.
+        const auto exponent = std::min< std::uint32_t >( bucket.failures++, 6 );
+        const auto backoff = std::chrono::duration< double >( std::ldexp( 1.0, static_cast< int >( exponent ) ) ) *
+                             std::uniform_real_distribution( 0.5, 1.0 )( random );
+
+        const auto delay = retry_after ? std::chrono::duration_cast< clock::duration >( *retry_after )
+                                       : std::chrono::duration_cast< clock::duration >( backoff );
+
+        bucket.blocked_until = std::max( bucket.blocked_until, clock::now() + delay );
+    }
+
+    governor::stats_t governor::stats() const noexcept
+    {
+        std::lock_guard lock( mutex );
+        return { throttled, rejected, std::chrono::duration_cast< std::chrono::milliseconds >( throttled_time ) };
+    }
+}  // namespace tsar::http
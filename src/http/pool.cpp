@@ -0,0 +1,285 @@
+#include "http/pool.hpp"
+
+#include <curl/curl.h>
+
+#include <format>
+#include <string_view>
+
+#include "resolver.hpp"
+
+namespace tsar::http
+{
+    namespace
+    {
+        /// <summary>
+        /// Performs the process-wide cURL initialization exactly once and cleans it up when the process exits.
+        /// </summary>
+        struct global_t
+        {
+            CURLcode code;
+
+            global_t() noexcept : code( curl_global_init( CURL_GLOBAL_DEFAULT ) )
+            {
+            }
+
+            ~global_t()
+            {
+                if ( code == CURLE_OK )
+                    curl_global_cleanup();
+            }
+        };
+
+        void lock_share( CURL*, curl_lock_data data, curl_lock_access, void* user )
+        {
+            static_cast< std::mutex* >( user )[ data ].lock();
+        }
+
+        void unlock_share( CURL*, curl_lock_data data, void* user )
+        {
+            static_cast< std::mutex* >( user )[ data ].unlock();
+        }
+    }  // namespace
+
+    bool global_init() noexcept
+    {
+        static const global_t global;
+        return global.code == CURLE_OK;
+    }
+
+    static_assert( CURL_LOCK_DATA_LAST <= 16, "the pool needs one lock per type of shared data" );
+
+    pool::lease::lease( pool* owner, void* curl ) noexcept : owner( owner ), curl( curl ), resolve( nullptr )
+    {
+    }
+
+    pool::lease::lease( lease&& other ) noexcept : owner( other.owner ), curl( other.curl ), resolve( other.resolve )
+    {
+        other.curl = nullptr;
+        other.resolve = nullptr;
+    }
+
+    pool::lease::~lease()
+    {
+        if ( curl )
+            owner->release( curl );
+
+        // The list may only be freed once the handle no longer refers to it.
+        if ( resolve )
+            curl_slist_free_all( static_cast< curl_slist* >( resolve ) );
+    }
+
+    void* pool::lease::handle() const noexcept
+    {
+        return curl;
+    }
+
+    void pool::lease::set_url( const std::string& url ) noexcept
+    {
+        curl_easy_setopt( curl, CURLOPT_URL, url.c_str() );
+
+        // Split "scheme://host[:port]/path" into its host and port.
+        const std::string_view view( url );
+        const auto scheme_end = view.find( "://" );
+
+        if ( scheme_end == std::string_view::npos )
+            return;
+
+        const auto scheme = view.substr( 0, scheme_end );
+        auto authority = view.substr( scheme_end + 3 );
+        authority = authority.substr( 0, authority.find_first_of( "/?#" ) );
+
+        // Literal IPv6 addresses and credentials are left to cURL.
+        if ( authority.empty() || authority.front() == '[' || authority.find( '@' ) != std::string_view::npos )
+            return;
+
+        auto host = authority;
+        std::string_view port = scheme == "http" ? "80" : "443";
+
+        if ( const auto colon = authority.find( ':' ); colon != std::string_view::npos )
+        {
+            host = authority.substr( 0, colon );
+            port = authority.substr( colon + 1 );
+        }
+
+        // A host name is at most 253 characters long, so the prefix of any valid URL fits, and the rest holds the addresses.
+        char buffer[ 1024 ];
+        const auto prefix = std::format_to_n( buffer, sizeof( buffer ) - 1, "{}:{}:", host, port );
+
+        if ( prefix.size >= static_cast< std::ptrdiff_t >( sizeof( buffer ) - 1 ) )
+            return;
+
+        // Every address of the host is pinned, so cURL still races IPv6 against IPv4 and fails over to the next address when one is down.
+        const auto addresses =
+            resolver::get().resolve_all( host, resolver::family_t::any, std::span( prefix.out, buffer + sizeof( buffer ) - 1 ) );
+
+        if ( !addresses )
+            return;
+
+        const auto end = prefix.out + addresses;
+        *end = '\0';
+        const std::string_view entry( buffer, end );
+
+        // Pinned addresses are permanent entries of the shared DNS cache, so a host only has to be pinned again when its addresses change.
+        {
+            std::lock_guard lock( owner->mutex );
+
+            if ( owner->pinned == entry )
+                return;
+
+            try
+            {
+                owner->pinned = entry;
+            }
+            catch ( const std::exception& )
+            {
+                return;
+            }
+        }
+
+        const auto list = curl_slist_append( static_cast< curl_slist* >( resolve ), buffer );
+
+        if ( !list )
+            return;
+
+        resolve = list;
+        curl_easy_setopt( curl, CURLOPT_RESOLVE, list );
+    }
+
+    pool::lease::operator bool() const noexcept
+    {
+        return curl != nullptr;
+    }
+
+    pool::pool( std::size_t max_idle ) noexcept : share( nullptr ),
+          max_idle( max_idle ),
+          requests( 0 ),
+          reused( 0 ),
+          max_response( envelope::default_max_size )
+    {
+        // cURL must be initialized before any handle is created, and before any other thread could race us to it.
+        if ( !global_init() )
+            return;
+
+        share = curl_share_init();
+
+        if ( !share )
+            return;
+
+        curl_share_setopt( share, CURLSHOPT_LOCKFUNC, lock_share );
+        curl_share_setopt( share, CURLSHOPT_UNLOCKFUNC, unlock_share );
+        curl_share_setopt( share, CURLSHOPT_USERDATA, locks.data() );
+
+        curl_share_setopt( share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT );
+        curl_share_setopt( share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION );
+        curl_share_setopt( share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS );
+    }
+
+    pool::~pool()
+    {
+        // Every handle has to be detached from the share object before the share object can be cleaned up.
+        for ( const auto curl : idle )
+            curl_easy_cleanup( curl );
+
+        if ( share )
+            curl_share_cleanup( share );
+    }
+
+    pool::lease pool::acquire() noexcept
+    {
+        void* curl = nullptr;
+
+        {
+            std::lock_guard lock( mutex );
+
+            if ( !idle.empty() )
+            {
+                curl = idle.back();
+                idle.pop_back();
+            }
+        }
+
+        if ( !curl )
+            curl = share ? curl_easy_init() : nullptr;
+
+        if ( curl )
+            configure( curl );
+
+        return lease( this, curl );
+    }
+
+    bool pool::perform( const lease& handle ) noexcept
+    {
+        if ( !handle )
+            return false;
+
+        const auto completed = curl_easy_perform( handle.handle() ) == CURLE_OK;
+
+        record( handle, completed );
+
+        return completed;
+    }
+
+    void pool::record( const lease& handle, bool completed ) noexcept
+    {
+        requests.fetch_add( 1, std::memory_order_relaxed );
+
+        if ( !completed )
+            return;
+
+        // The number of new connections the transfer had to make. Zero means the request went out over a cached connection.
+        long connects = 0;
+        if ( curl_easy_getinfo( handle.handle(), CURLINFO_NUM_CONNECTS, &connects ) == CURLE_OK && connects == 0 )
+            reused.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    pool::stats_t pool::stats() const noexcept
+    {
+        return { requests.load( std::memory_order_relaxed ), reused.load( std::memory_order_relaxed ) };
+    }
+
+    std::size_t pool::max_response_size() const noexcept
+    {
+        return max_response.load( std::memory_order_relaxed );
+    }
+
+    void pool::set_max_response_size( std::size_t bytes ) noexcept
+    {
+        max_response.store( bytes, std::memory_order_relaxed );
+    }
+
+    http::governor& pool::governor() noexcept
+    {
+        return limiter;
+    }
+
+    void pool::release( void* curl ) noexcept
+    {
+        // Resetting the handle drops the options of the previous request but keeps its caches alive.
+        curl_easy_reset( curl );
+
+        {
+            std::lock_guard lock( mutex );
+
+            if ( idle.size() < max_idle )
+            {
+                try
+                {
+                    idle.push_back( curl );
+                    return;
+                }
+                catch ( const std::exception& )
+                {
+                }
+            }
+        }
+
+        curl_easy_cleanup( curl );
+    }
+
+    void pool::configure( void* curl ) const noexcept
+    {
+        curl_easy_setopt( curl, CURLOPT_SHARE, share );
+        curl_easy_setopt( curl, CURLOPT_NOSIGNAL, 1L );
+        curl_easy_setopt( curl, CURLOPT_TCP_KEEPALIVE, 1L );
+    }
+}  // namespace tsar::http
@@ -1,5 +1,7 @@
 #include "ntp/client.hpp"
 
+#include "resolver.hpp"
+
 #include <sys/types.h>
 
 #include <cstring>
@@ -11,49 +13,141 @@
 #define close( X ) closesocket( X )
 #else
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/timex.h>
+#endif
+
+#include <cerrno>
 #endif
 #include <string.h>
 #include <time.h>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <tuple>
 
 namespace tsar::ntp
 {
-    client::client( const std::string_view host, std::uint16_t port ) : hostname( host ), port( port ), socket_fd( 0 ), socket_client{}
+    client::client( const std::string_view host, std::uint16_t port ) : client( std::array{ std::pair{ host, port } } )
+    {
+    }
+
+    client::client( std::span< const std::pair< std::string_view, std::uint16_t > > servers )
+        : names( resolver::get() ),
+          random( std::random_device{}() ),
+          in_flight( false ),
+          flights( 0 ),
+          source( source_t::network ),
+          kernel_tolerance( default_kernel_tolerance ),
+          refresh_interval( default_refresh_interval ),
+          refresh_requested( false ),
+          stopping( false )
     {
 #ifdef _WIN32
         WSADATA wsaData = { 0 };
         ( void )WSAStartup( MAKEWORD( 2, 2 ), &wsaData );
 #endif
+        for ( const auto& [ host, port ] : servers )
+            this->servers.push_back( { std::string( host ), port } );
     }
 
-    result_t< void > client::build_connection() noexcept
+    result_t< void > client::build_connection( server_t& server ) noexcept
     {
-        // Creating socket file descriptor
-        if ( ( socket_fd = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP ) ) < 0 )
-            return std::unexpected( error( ntp::error_code_t::failed_to_build_connection_t ) );
-
-        memset( &socket_client, 0, sizeof( socket_client ) );
+        // Close the socket that failed, if any.
+        close_socket( server );
 
-        const auto ntp_server_ip = hostname_to_ip( hostname );
+        char ntp_server_ip[ INET6_ADDRSTRLEN ];
 
-        if ( ntp_server_ip.empty() )
+        if ( !hostname_to_ip( server.hostname, ntp_server_ip ) )
             return std::unexpected( error( ntp::error_code_t::failed_to_resolve_hostname_t ) );
 
+        // Creating socket file descriptor
+        if ( ( server.socket_fd = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP ) ) < 0 )
+        {
+            server.socket_fd = static_cast< socket_t >( -1 );
+            return std::unexpected( error( ntp::error_code_t::failed_to_build_connection_t ) );
+        }
+
         // Filling server information
+        struct sockaddr_in socket_client{};
         socket_client.sin_family = AF_INET;
-        socket_client.sin_port = htons( port );
-        inet_pton( AF_INET, ntp_server_ip.c_str(), &socket_client.sin_addr );
+        socket_client.sin_port = htons( server.port );
+        inet_pton( AF_INET, ntp_server_ip, &socket_client.sin_addr );
+
+        // The socket stays connected to the server, so that it only receives the responses of the server and is reused for every request.
+        // It is non-blocking, so that the responses of every server are drained as they arrive.
+#ifdef _WIN32
+        u_long non_blocking = 1;
+        const auto configured = ioctlsocket( server.socket_fd, FIONBIO, &non_blocking ) == 0;
+#else
+        const auto flags = fcntl( server.socket_fd, F_GETFL, 0 );
+        const auto configured = flags >= 0 && fcntl( server.socket_fd, F_SETFL, flags | O_NONBLOCK ) == 0;
+#endif
+
+        if ( !configured || connect( server.socket_fd, reinterpret_cast< struct sockaddr* >( &socket_client ), sizeof( socket_client ) ) < 0 )
+        {
+            close_socket( server );
+            return std::unexpected( error( ntp::error_code_t::failed_to_build_connection_t ) );
+        }
 
         return {};
     }
 
+    void client::set_server( const std::string_view host, std::uint16_t port )
+    {
+        std::unique_lock lock( request_mutex );
+
+        // The sockets belong to the measurement in flight, so they are only closed after that measurement landed.
+        landed.wait( lock, [ this ] { return !in_flight; } );
+
+        for ( auto& server : servers )
+            close_socket( server );
+
+        servers.clear();
+        servers.push_back( { std::string( host ), port } );
+    }
+
+    void client::add_server( const std::string_view host, std::uint16_t port )
+    {
+        std::unique_lock lock( request_mutex );
+        landed.wait( lock, [ this ] { return !in_flight; } );
+
+        servers.push_back( { std::string( host ), port } );
+    }
+
+    void client::set_source( source_t source, std::chrono::milliseconds tolerance )
+    {
+        const std::lock_guard lock( request_mutex );
+        this->source = source;
+        kernel_tolerance = tolerance;
+    }
+
+    void client::set_refresh_interval( std::chrono::seconds interval )
+    {
+        const std::lock_guard lock( mutex );
+        refresh_interval = std::max( interval, minimum_refresh_interval );
+    }
+
     client::~client()
     {
-        close_socket();
+        {
+            const std::lock_guard lock( mutex );
+            stopping = true;
+        }
+
+        wake.notify_one();
+
+        if ( refresher.joinable() )
+            refresher.join();
+
+        for ( auto& server : servers )
+            close_socket( server );
 
 #ifdef _WIN32
         WSACleanup();
@@ -62,83 +156,339 @@ namespace tsar::ntp
 
     result_t< time_t > client::request_time()
     {
-        const auto result = build_connection();
+        const auto measured = measure();
 
-        if ( !result )
-            return std::unexpected( result.error() );
+        if ( !measured )
+            return std::unexpected( measured.error() );
 
-        if ( connect( socket_fd, reinterpret_cast< struct sockaddr* >( &socket_client ), sizeof( socket_client ) ) < 0 )
-            return std::unexpected( error( ntp::error_code_t::failed_to_build_connection_t ) );
-
-        packet_t packet{};
-        packet.li_vn_mode = 0x23;
+        return std::chrono::system_clock::to_time_t( measured->ntp_time );
+    }
 
-        if ( sendto(
-                 socket_fd,
-                 reinterpret_cast< const char* >( &packet ),
-                 sizeof( packet_t ),
-                 0,
-                 reinterpret_cast< struct sockaddr* >( &socket_client ),
-                 sizeof( socket_client ) ) < 0 )
-            return std::unexpected( error( ntp::error_code_t::failed_to_send_packet_t ) );
+    result_t< client::sample_t > client::measure()
+    {
+        std::unique_lock lock( request_mutex );
 
-        // reset the packet buffer
-        memset( &packet, 0, sizeof( packet_t ) );
+        // A clock that is already disciplined by the system needs no network round trip.
+        if ( source == source_t::automatic )
+        {
+            if ( const auto measured = kernel_sample() )
+                return *measured;
+        }
 
-        if ( recvfrom( socket_fd, reinterpret_cast< char* >( &packet ), sizeof( packet_t ), 0, nullptr, nullptr ) < 0 )
+        // Callers that arrive while a measurement is in flight share its result, so only one thread at a time uses the sockets.
+        if ( in_flight )
         {
-            close_socket();
-            return std::unexpected( error( ntp::error_code_t::failed_to_receive_packet_t ) );
+            const auto flight = flights;
+            landed.wait( lock, [ this, flight ] { return flights != flight; } );
+            return last_result;
         }
 
-        // These two fields contain the time-stamp seconds as the packet left the NTP
-        // server. The number of seconds correspond to the seconds passed since 1900.
-        // ntohl() converts the bit/byte order from the network's to host's
-        // "endianness".
+        in_flight = true;
+        lock.unlock();
 
-        packet.transmited_timestamp_sec = ntohl( packet.transmited_timestamp_sec );            // Time-stamp seconds.
-        packet.transmited_timestamp_sec_frac = ntohl( packet.transmited_timestamp_sec_frac );  // Time-stamp fraction of a second.
+        const auto result = query();
 
-        // Extract the 32 bits that represent the time-stamp seconds (since NTP epoch)
-        // from when the packet left the server. Subtract 70 years worth of seconds
-        // from the seconds since 1900. This leaves the seconds since the UNIX epoch
-        // of 1970.
-        // (1900)---------(1970)**********(Time Packet Left the Server)
+        lock.lock();
+        last_result = result;
+        ++flights;
+        in_flight = false;
+        landed.notify_all();
 
-        // seconds since UNIX epoch
-        uint32_t txTm = packet.transmited_timestamp_sec - NTP_TIMESTAMP_DELTA;
+        return result;
+    }
 
-        return txTm;
+    std::optional< client::sample_t > client::kernel_sample() const noexcept
+    {
+#ifdef __linux__
+        // Reads the state of the kernel clock without changing it, which needs no privileges. Setting the clock by hand marks it as
+        // unsynchronized until a time daemon disciplines it again.
+        struct timex state{};
+        const auto clock_state = adjtimex( &state );
+
+        if ( clock_state < 0 || clock_state == TIME_ERROR || ( state.status & STA_UNSYNC ) ||
+             std::chrono::microseconds( state.maxerror ) > kernel_tolerance )
+            return std::nullopt;
+
+        const auto system_now = std::chrono::system_clock::now();
+        return sample_t{ system_now, system_now, std::chrono::steady_clock::now() };
+#else
+        return std::nullopt;
+#endif
     }
 
-    std::string client::hostname_to_ip( const std::string_view host )
+    std::chrono::system_clock::time_point client::to_time_point( std::uint32_t seconds, std::uint32_t fraction ) noexcept
     {
-        addrinfo hints{}, *res = nullptr;
-        hints.ai_family = AF_INET;       // IPv4
-        hints.ai_socktype = SOCK_DGRAM;  // Datagram socket (UDP)
+        // The seconds count from 1900, and the fraction is in units of 2^-32 seconds.
+        const auto since_1900 = std::chrono::seconds( ntohl( seconds ) ) +
+                                std::chrono::duration_cast< std::chrono::nanoseconds >(
+                                    std::chrono::duration< std::int64_t, std::ratio< 1, 0x100000000 > >( ntohl( fraction ) ) );
 
-        int status = getaddrinfo( host.data(), nullptr, &hints, &res );
+        return std::chrono::system_clock::time_point(
+            std::chrono::duration_cast< std::chrono::system_clock::duration >( since_1900 - std::chrono::seconds( NTP_TIMESTAMP_DELTA ) ) );
+    }
+
+    /// <summary>
+    /// Whether the last socket operation failed only because no packet was waiting.
+    /// </summary>
+    static bool would_block() noexcept
+    {
+#ifdef _WIN32
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+    }
 
-        if ( status != 0 )
-            return {};
+    result_t< client::sample_t > client::query() noexcept
+    {
+        auto failure = error( ntp::error_code_t::failed_to_receive_packet_t );
 
-        char ip_str[ INET_ADDRSTRLEN ];
-        if ( res )
+        /// <summary>
+        /// The best response so far, with the round-trip delay and the stratum it is ranked by.
+        /// </summary>
+        struct candidate_t
         {
-            inet_ntop( AF_INET, &( reinterpret_cast< sockaddr_in* >( res->ai_addr )->sin_addr ), ip_str, INET_ADDRSTRLEN );
-            freeaddrinfo( res );
-            return std::string( ip_str );
+            sample_t sample;
+            std::chrono::milliseconds delay;
+            std::uint8_t stratum;
+        };
+
+        std::optional< candidate_t > best;
+#ifdef _WIN32
+        std::vector< WSAPOLLFD > descriptors;
+#else
+        std::vector< pollfd > descriptors;
+#endif
+        std::vector< server_t* > polled;
+
+        for ( std::size_t attempt = 0; attempt < max_attempts && !best; ++attempt )
+        {
+            for ( auto& server : servers )
+            {
+                server.pending = false;
+
+                // The sockets are kept between requests, and rebuilt after they failed.
+                if ( server.socket_fd == static_cast< socket_t >( -1 ) )
+                {
+                    if ( const auto result = build_connection( server ); !result )
+                    {
+                        failure = result.error();
+                        continue;
+                    }
+                }
+
+                packet_t packet{};
+                packet.li_vn_mode = 0x23;
+
+                // The request is tagged with a random transmit timestamp, which the server echoes as the originate timestamp. That tells its
+                // response apart from a late response to an earlier attempt. The actual time the request was sent is kept here instead.
+                server.tag = random();
+                packet.transmited_timestamp_sec = static_cast< std::uint32_t >( server.tag >> 32 );
+                packet.transmited_timestamp_sec_frac = static_cast< std::uint32_t >( server.tag );
+                server.sent = std::chrono::system_clock::now();
+
+                if ( send( server.socket_fd, reinterpret_cast< const char* >( &packet ), sizeof( packet_t ), 0 ) < 0 )
+                {
+                    failure = error( ntp::error_code_t::failed_to_send_packet_t );
+                    close_socket( server );
+                    continue;
+                }
+
+                server.pending = true;
+            }
+
+            const auto started = std::chrono::steady_clock::now();
+            auto deadline = started + attempt_timeout;
+
+            while ( true )
+            {
+                descriptors.clear();
+                polled.clear();
+
+                for ( auto& server : servers )
+                {
+                    if ( !server.pending )
+                        continue;
+
+#ifdef _WIN32
+                    descriptors.push_back( { server.socket_fd, POLLRDNORM, 0 } );
+#else
+                    descriptors.push_back( { server.socket_fd, POLLIN, 0 } );
+#endif
+                    polled.push_back( &server );
+                }
+
+                const auto remaining = std::chrono::ceil< std::chrono::milliseconds >( deadline - std::chrono::steady_clock::now() );
+
+                if ( descriptors.empty() || remaining <= std::chrono::milliseconds::zero() )
+                    break;
+
+#ifdef _WIN32
+                const auto ready = WSAPoll( descriptors.data(), static_cast< ULONG >( descriptors.size() ), static_cast< int >( remaining.count() ) );
+#else
+                const auto ready = poll( descriptors.data(), descriptors.size(), static_cast< int >( remaining.count() ) );
+
+                if ( ready < 0 && errno == EINTR )
+                    continue;
+#endif
+
+                if ( ready == 0 )
+                    break;
+
+                if ( ready < 0 )
+                {
+                    failure = error( ntp::error_code_t::failed_to_receive_packet_t );
+                    break;
+                }
+
+                for ( std::size_t i = 0; i < descriptors.size(); ++i )
+                {
+                    if ( !descriptors[ i ].revents )
+                        continue;
+
+                    auto& server = *polled[ i ];
+
+                    // Drain every packet that is waiting, since stale responses to earlier attempts may be queued before the awaited one.
+                    while ( server.pending )
+                    {
+                        packet_t response{};
+                        const auto received = recv( server.socket_fd, reinterpret_cast< char* >( &response ), sizeof( packet_t ), 0 );
+                        const auto arrived = std::chrono::system_clock::now();
+
+                        if ( received < 0 )
+                        {
+                            // An error, e.g. an ICMP port unreachable reported on the connected socket, rebuilds the connection for the next
+                            // attempt.
+                            if ( !would_block() )
+                            {
+                                failure = error( ntp::error_code_t::failed_to_receive_packet_t );
+                                server.pending = false;
+                                close_socket( server );
+                            }
+
+                            break;
+                        }
+
+                        // Skip truncated packets, packets that are not server responses, and late responses to earlier attempts.
+                        if ( static_cast< std::size_t >( received ) < sizeof( packet_t ) || ( response.li_vn_mode & 0x07 ) != 4 ||
+                             response.orig_timestamp_sec != static_cast< std::uint32_t >( server.tag >> 32 ) ||
+                             response.orig_timestamp_sec_frac != static_cast< std::uint32_t >( server.tag ) )
+                            continue;
+
+                        server.pending = false;
+
+                        // Servers that are not synchronized (leap indicator 3) or that answer with a kiss-o'-death (stratum 0) are ignored.
+                        if ( ( response.li_vn_mode >> 6 ) == 3 || response.stratum == 0 || response.stratum > 15 )
+                            continue;
+
+                        // With the time the request was sent (t1), received by the server (t2), sent back by the server (t3) and received here
+                        // (t4), the offset of the system clock is ((t2 - t1) + (t3 - t4)) / 2, and the round-trip delay without the time spent in
+                        // the server is (t4 - t1) - (t3 - t2).
+                        const auto t2 = to_time_point( response.received_timestamp_sec, response.received_timestamp_sec_frac );
+                        const auto t3 = to_time_point( response.transmited_timestamp_sec, response.transmited_timestamp_sec_frac );
+                        const auto offset = ( ( t2 - server.sent ) + ( t3 - arrived ) ) / 2;
+                        const auto delay = std::max( ( arrived - server.sent ) - ( t3 - t2 ), std::chrono::system_clock::duration::zero() );
+
+                        // The response with the lowest delay has the smallest error, and delays within the same millisecond are ranked by stratum.
+                        const candidate_t candidate{ { arrived + offset, arrived, std::chrono::steady_clock::now() },
+                                                     std::chrono::duration_cast< std::chrono::milliseconds >( delay ),
+                                                     response.stratum };
+
+                        if ( !best || std::tie( candidate.delay, candidate.stratum ) < std::tie( best->delay, best->stratum ) )
+                        {
+                            // The first response sets how long the other servers are waited for: one that answers after twice that long is
+                            // unlikely to have a lower delay, and a slow server is kept out of the measurement.
+                            if ( !best )
+                                deadline = std::min( deadline, candidate.sample.steady_time + ( candidate.sample.steady_time - started ) );
+
+                            best = candidate;
+                        }
+                    }
+                }
+            }
         }
 
-        return {};
+        // The requests of the servers that did not answer are abandoned, their late responses are skipped by their tag.
+        for ( auto& server : servers )
+            server.pending = false;
+
+        if ( !best )
+            return std::unexpected( failure );
+
+        return best->sample;
+    }
+
+    result_t< std::chrono::system_clock::time_point > client::now()
+    {
+        std::unique_lock lock( mutex );
+
+        // The first measurement is made by the caller, and concurrent callers wait for it. Every later one is made in the background.
+        if ( !sample )
+        {
+            const auto measured = measure();
+
+            if ( !measured )
+                return std::unexpected( measured.error() );
+
+            sample = *measured;
+
+            if ( !refresher.joinable() )
+                refresher = std::thread( &client::refresh_loop, this );
+        }
+
+        const auto steady_now = std::chrono::steady_clock::now();
+        const auto system_now = std::chrono::system_clock::now();
+        const auto elapsed = std::chrono::duration_cast< std::chrono::system_clock::duration >( steady_now - sample->steady_time );
+
+        // If the system clock moved differently from the steady clock, it was set, and the offset between the two is measured again.
+        const auto drift = ( system_now - sample->system_time ) - elapsed;
+
+        if ( ( drift > jump_threshold || drift < -jump_threshold ) && !refresh_requested )
+        {
+            refresh_requested = true;
+            wake.notify_one();
+        }
+
+        return sample->ntp_time + elapsed;
+    }
+
+    void client::refresh_loop()
+    {
+        std::unique_lock lock( mutex );
+
+        while ( !stopping )
+        {
+            // Measurements are spaced out even when they are requested early.
+            wake.wait_for( lock, minimum_refresh_interval, [ this ] { return stopping; } );
+            wake.wait_for( lock, refresh_interval - minimum_refresh_interval, [ this ] { return stopping || refresh_requested; } );
+
+            if ( stopping )
+                break;
+
+            lock.unlock();
+            const auto measured = measure();
+            lock.lock();
+
+            // A failed measurement keeps the previous sample, so an unreachable server does not fail every request.
+            if ( measured )
+                sample = *measured;
+
+            refresh_requested = false;
+        }
+    }
+
+    bool client::hostname_to_ip( const std::string_view host, std::span< char > address )
+    {
+        // The address is served from the cache shared with the HTTPS requests, so only the first request of the process blocks on a lookup.
+        return names.resolve( host, resolver::family_t::ipv4, address ) != 0;
     }
 
-    void client::close_socket()
+    void client::close_socket( server_t& server )
     {
-        if ( socket_fd != -1 )
+        if ( server.socket_fd != static_cast< socket_t >( -1 ) )
         {
-            close( socket_fd );
-            socket_fd = -1;
+            close( server.socket_fd );
+            server.socket_fd = static_cast< socket_t >( -1 );
         }
     }
 
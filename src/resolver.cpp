@@ -0,0 +1,248 @@
+#include "resolver.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#include <Ws2tcpip.h>
+#pragma comment( lib, "Ws2_32.lib" )
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#endif
+
+namespace tsar
+{
+    resolver& resolver::get() noexcept
+    {
+        static resolver instance;
+        return instance;
+    }
+
+    resolver::resolver() noexcept : ttl( std::chrono::minutes( 5 ) ), stopping( false )
+    {
+#ifdef _WIN32
+        WSADATA wsaData = { 0 };
+        ( void )WSAStartup( MAKEWORD( 2, 2 ), &wsaData );
+#endif
+    }
+
+    resolver::~resolver()
+    {
+        {
+            std::lock_guard lock( mutex );
+            stopping = true;
+        }
+
+        wakeup.notify_all();
+
+        if ( thread.joinable() )
+            thread.join();
+
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    template < typename Visitor >
+    bool resolver::visit( const std::string_view host, family_t family, Visitor&& visitor ) noexcept
+    {
+        try
+        {
+            {
+                std::lock_guard lock( mutex );
+
+                const auto it = entries.find( std::pair( host, family ) );
+
+                // Expired entries are served as well. They are the last good addresses of a host the refresher failed to resolve.
+                if ( it != entries.end() )
+                {
+                    it->second.last_used = clock::now();
+                    visitor( it->second.addresses );
+                    return true;
+                }
+            }
+
+            // The host is only copied when it is not cached yet.
+            key_t key{ std::string( host ), family };
+
+            auto addresses = lookup( key.first, family );
+
+            if ( !addresses )
+                return false;
+
+            std::call_once( started, [ this ] { thread = std::thread( &resolver::refresh, this ); } );
+
+            std::lock_guard lock( mutex );
+
+            const auto now = clock::now();
+            const auto it = entries.insert_or_assign( std::move( key ), entry_t{ std::move( *addresses ), now + ttl, now } ).first;
+
+            wakeup.notify_all();
+
+            visitor( it->second.addresses );
+            return true;
+        }
+        catch ( const std::exception& )
+        {
+            return false;
+        }
+    }
+
+    std::size_t resolver::resolve( const std::string_view host, family_t family, std::span< char > buffer ) noexcept
+    {
+        std::size_t length = 0;
+
+        visit( host, family, [ &buffer, &length ]( const std::vector< std::string >& addresses )
+        {
+            const auto& address = addresses.front();
+
+            if ( address.size() >= buffer.size() )
+                return;
+
+            length = static_cast< std::size_t >( std::copy( address.begin(), address.end(), buffer.begin() ) - buffer.begin() );
+            buffer[ length ] = '\0';
+        } );
+
+        return length;
+    }
+
+    std::size_t resolver::resolve_all( const std::string_view host, family_t family, std::span< char > buffer ) noexcept
+    {
+        std::size_t length = 0;
+
+        visit( host, family, [ &buffer, &length ]( const std::vector< std::string >& addresses )
+        {
+            for ( const auto& address : addresses )
+            {
+                const auto bracketed = address.find( ':' ) != std::string::npos;
+                const auto size = address.size() + ( bracketed ? 2 : 0 ) + ( length ? 1 : 0 );
+
+                if ( length + size > buffer.size() )
+                    break;
+
+                if ( length )
+                    buffer[ length++ ] = ',';
+
+                if ( bracketed )
+                    buffer[ length++ ] = '[';
+
+                length = static_cast< std::size_t >( std::copy( address.begin(), address.end(), buffer.begin() + length ) - buffer.begin() );
+
+                if ( bracketed )
+                    buffer[ length++ ] = ']';
+            }
+        } );
+
+        return length;
+    }
+
+    void resolver::set_ttl( std::chrono::seconds ttl ) noexcept
+    {
+        std::lock_guard lock( mutex );
+        this->ttl = std::max( ttl, std::chrono::seconds( 1 ) );
+    }
+
+    std::optional< std::vector< std::string > > resolver::lookup( const std::string& host, family_t family ) noexcept
+    {
+        addrinfo hints{}, *res = nullptr;
+        hints.ai_family = family == family_t::ipv4 ? AF_INET : AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+
+        if ( getaddrinfo( host.c_str(), nullptr, &hints, &res ) != 0 || !res )
+            return std::nullopt;
+
+        std::vector< std::string > addresses;
+
+        try
+        {
+            // The system resolver returns the addresses in the order they should be tried, which is kept.
+            for ( auto info = res; info; info = info->ai_next )
+            {
+                char ip_str[ INET6_ADDRSTRLEN ]{};
+                const char* result = nullptr;
+
+                if ( info->ai_family == AF_INET )
+                    result = inet_ntop( AF_INET, &reinterpret_cast< sockaddr_in* >( info->ai_addr )->sin_addr, ip_str, sizeof( ip_str ) );
+                else if ( info->ai_family == AF_INET6 )
+                    result = inet_ntop( AF_INET6, &reinterpret_cast< sockaddr_in6* >( info->ai_addr )->sin6_addr, ip_str, sizeof( ip_str ) );
+
+                if ( result && std::find( addresses.begin(), addresses.end(), ip_str ) == addresses.end() )
+                    addresses.emplace_back( ip_str );
+            }
+        }
+        catch ( const std::exception& )
+        {
+            addresses.clear();
+        }
+
+        freeaddrinfo( res );
+
+        if ( addresses.empty() )
+            return std::nullopt;
+
+        return addresses;
+    }
+
+    void resolver::refresh() noexcept
+    {
+        std::unique_lock lock( mutex );
+
+        while ( !stopping )
+        {
+            const auto now = clock::now();
+
+            // Entries are refreshed once four fifths of their lifetime have passed, so callers never have to wait on a lookup.
+            const auto ahead = ttl / 5;
+            auto next = now + ttl;
+
+            std::vector< key_t > due;
+
+            for ( auto it = entries.begin(); it != entries.end(); )
+            {
+                // A host nobody asked for during two lifetimes is dropped instead of being refreshed forever.
+                if ( now - it->second.last_used > ttl * 2 )
+                {
+                    it = entries.erase( it );
+                    continue;
+                }
+
+                if ( it->second.expires - ahead <= now )
+                    due.push_back( it->first );
+                else
+                    next = std::min( next, it->second.expires - ahead );
+
+                ++it;
+            }
+
+            lock.unlock();
+
+            for ( const auto& key : due )
+            {
+                auto addresses = lookup( key.first, key.second );
+
+                std::lock_guard guard( mutex );
+
+                const auto it = entries.find( key );
+
+                if ( it == entries.end() )
+                    continue;
+
+                // On failure the last good addresses stay in place and the lookup is retried a little later.
+                if ( addresses )
+                {
+                    it->second.addresses = std::move( *addresses );
+                    it->second.expires = clock::now() + ttl;
+                }
+                else
+                    next = std::min( next, clock::now() + std::chrono::seconds( 5 ) );
+            }
+
+            lock.lock();
+
+            wakeup.wait_until( lock, next, [ this ] { return stopping; } );
+        }
+    }
+}  // namespace tsar
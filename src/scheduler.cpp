@@ -0,0 +1,461 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <future>
+
+namespace tsar
+{
+    scheduler::scheduler() : scheduler( options_t{} )
+    {
+    }
+
+    scheduler::scheduler( options_t options )
+        : options( options ),
+          free_list( npos ),
+          start( clock::now() ),
+          current( 0 ),
+          random( std::random_device{}() ),
+          sessions( 0 ),
+          fired( 0 ),
+          total_lag( 0 ),
+          max_lag( 0 ),
+          stopping( false )
+    {
+        this->options.resolution = std::max( this->options.resolution, std::chrono::milliseconds( 1 ) );
+        this->options.jitter = std::clamp( this->options.jitter, 0.0, 1.0 );
+        this->options.workers = std::max< std::size_t >( this->options.workers, 1 );
+        this->options.batch_size = std::max< std::size_t >( this->options.batch_size, 1 );
+        this->options.retry_delay = std::max( this->options.retry_delay, this->options.resolution );
+
+        for ( auto& level : wheel )
+            level.fill( npos );
+
+        ticker = std::thread( &scheduler::tick, this );
+
+        for ( std::size_t i = 0; i < this->options.workers; ++i )
+            workers.emplace_back( &scheduler::work, this );
+    }
+
+    scheduler::~scheduler()
+    {
+        {
+            std::lock_guard lock( mutex );
+            stopping = true;
+        }
+
+        wakeup.notify_all();
+        ready.notify_all();
+
+        ticker.join();
+
+        for ( auto& worker : workers )
+            worker.join();
+    }
+
+    scheduler::id_t scheduler::add( user session, callback_t callback )
+    {
+        auto shared = std::make_shared< const user >( std::move( session ) );
+
+        std::lock_guard lock( mutex );
+
+        std::uint32_t index = free_list;
+
+        if ( index != npos )
+            free_list = entries[ index ].next;
+        else
+        {
+            index = static_cast< std::uint32_t >( entries.size() );
+            entries.emplace_back();
+        }
+
+        auto& entry = entries[ index ];
+        entry.session = std::move( shared );
+        entry.callback = std::move( callback );
+        entry.state = state_t::armed;
+        entry.failures = 0;
+
+        // Spreading the first heartbeats over a whole interval keeps sessions that were registered together from firing together.
+        arm( index, clock::now(),
+             std::chrono::duration_cast< clock::duration >( options.interval * std::uniform_real_distribution( 0.0, 1.0 )( random ) ) );
+
+        ++sessions;
+
+        return static_cast< id_t >( entry.generation ) << 32 | index;
+    }
+
+    bool scheduler::remove( id_t id ) noexcept
+    {
+        std::lock_guard lock( mutex );
+
+        const auto entry = find( id );
+
+        if ( !entry || entry->state == state_t::cancelled )
+            return false;
+
+        const auto index = static_cast< std::uint32_t >( id );
+
+        // A running entry is released by the worker that fires it, once its heartbeat completes.
+        if ( entry->state == state_t::running )
+            entry->state = state_t::cancelled;
+        else
+        {
+            unlink( index );
+            release( index );
+        }
+
+        --sessions;
+        return true;
+    }
+
+    scheduler::stats_t scheduler::stats() const noexcept
+    {
+        std::lock_guard lock( mutex );
+
+        const auto average = fired ? total_lag / static_cast< clock::rep >( fired ) : clock::duration::zero();
+
+        return {
+            sessions,
+            fired,
+            std::chrono::duration_cast< std::chrono::microseconds >( average ),
+            std::chrono::duration_cast< std::chrono::microseconds >( max_lag ),
+        };
+    }
+
+    void scheduler::tick() noexcept
+    {
+        std::unique_lock lock( mutex );
+
+        while ( !stopping )
+        {
+            const auto now = clock::now();
+
+            std::vector< id_t > due;
+
+            while ( start + ( current + 1 ) * options.resolution <= now )
+                advance( now, due );
+
+            // Hand the due heartbeats to the workers in batches.
+            std::size_t queued = 0;
+
+            try
+            {
+                for ( ; queued < due.size(); queued += options.batch_size )
+                {
+                    const auto end = std::min( due.size(), queued + options.batch_size );
+                    batches.emplace_back( due.begin() + queued, due.begin() + end );
+                }
+            }
+            catch ( const std::exception& )
+            {
+                // Keep the sessions that were not handed over scheduled rather than losing them.
+                for ( auto i = queued; i < due.size(); ++i )
+                {
+                    const auto index = static_cast< std::uint32_t >( due[ i ] );
+
+                    entries[ index ].state = state_t::armed;
+                    arm( index, now, std::chrono::duration_cast< clock::duration >( options.interval ) );
+                }
+            }
+
+            if ( !due.empty() )
+                ready.notify_all();
+
+            wakeup.wait_until( lock, start + ( current + 1 ) * options.resolution, [ this ] { return stopping; } );
+        }
+    }
+
+    void scheduler::work() noexcept
+    {
+        while ( true )
+        {
+            std::vector< id_t > batch;
+
+            {
+                std::unique_lock lock( mutex );
+                ready.wait( lock, [ this ] { return stopping || !batches.empty(); } );
+
+                if ( stopping )
+                    return;
+
+                batch = std::move( batches.front() );
+                batches.pop_front();
+            }
+
+            fire( batch );
+        }
+    }
+
+    void scheduler::fire( const std::vector< id_t >& batch ) noexcept
+    {
+        std::vector< std::shared_ptr< const user > > sessions_to_fire( batch.size() );
+
+        {
+            std::lock_guard lock( mutex );
+
+            const auto now = clock::now();
+
+            for ( std::size_t i = 0; i < batch.size(); ++i )
+            {
+                const auto entry = find( batch[ i ] );
+
+                if ( !entry )
+                    continue;
+
+                // A session that was removed while its batch waited for a worker is released here, it is not fired.
+                if ( entry->state == state_t::cancelled )
+                {
+                    release( static_cast< std::uint32_t >( batch[ i ] ) );
+                    continue;
+                }
+
+                if ( entry->state != state_t::running )
+                    continue;
+
+                sessions_to_fire[ i ] = entry->session;
+
+                // The lag is measured when the heartbeat is actually sent, so it includes the time the batch was queued.
+                const auto lag = std::max( now - entry->deadline, clock::duration::zero() );
+
+                total_lag += lag;
+                max_lag = std::max( max_lag, lag );
+                ++fired;
+            }
+        }
+
+        // Every heartbeat of the batch is in flight on the I/O thread at once, the worker only waits for them to complete.
+        std::vector< std::future< result_t< void > > > results( batch.size() );
+
+        for ( std::size_t i = 0; i < batch.size(); ++i )
+        {
+            if ( !sessions_to_fire[ i ] )
+                continue;
+
+            try
+            {
+                results[ i ] = sessions_to_fire[ i ]->heartbeat_async();
+            }
+            catch ( const std::exception& )
+            {
+            }
+        }
+
+        for ( std::size_t i = 0; i < batch.size(); ++i )
+        {
+            if ( !sessions_to_fire[ i ] )
+                continue;
+
+            result_t< void > result = std::unexpected( error( error_code_t::unexpected_error_t ) );
+
+            if ( results[ i ].valid() )
+            {
+                try
+                {
+                    result = results[ i ].get();
+                }
+                catch ( const std::exception& )
+                {
+                }
+            }
+
+            callback_t callback;
+
+            {
+                std::lock_guard lock( mutex );
+
+                const auto entry = find( batch[ i ] );
+                const auto index = static_cast< std::uint32_t >( batch[ i ] );
+
+                if ( !entry )
+                    continue;
+
+                if ( entry->state == state_t::cancelled )
+                {
+                    release( index );
+                    continue;
+                }
+
+                if ( result )
+                {
+                    entry->state = state_t::armed;
+                    entry->failures = 0;
+                    arm( index, clock::now(), jittered_interval() );
+                    continue;
+                }
+
+                // A failure that may be transient, e.g. a timeout or a server error, is retried with an exponential backoff.
+                if ( !is_rejection( result.error() ) )
+                {
+                    entry->state = state_t::armed;
+                    ++entry->failures;
+
+                    const auto backoff = options.retry_delay * ( std::uint64_t{ 1 } << std::min< std::uint32_t >( entry->failures - 1, 16 ) );
+                    const auto delay = std::min< clock::duration >( backoff, options.interval );
+
+                    arm( index, clock::now(),
+                         std::chrono::duration_cast< clock::duration >( delay * std::uniform_real_distribution( 1.0 - options.jitter, 1.0 )( random ) ) );
+                    continue;
+                }
+
+                callback = std::move( entry->callback );
+                release( index );
+                --sessions;
+            }
+
+            if ( callback )
+            {
+                try
+                {
+                    callback( batch[ i ], result.error() );
+                }
+                catch ( const std::exception& )
+                {
+                }
+            }
+        }
+    }
+
+    void scheduler::link( std::uint32_t index ) noexcept
+    {
+        auto& entry = entries[ index ];
+
+        // Sessions that are further away than the wheel reaches are parked in the last slot they can reach and cascaded down from there. Only
+        // the slot is clamped, the entry keeps its expiry tick, so that it is parked again until it is in reach rather than fired early.
+        const auto target = std::clamp< std::uint64_t >( entry.expires, current + 1, current + ( std::uint64_t{ 1 } << ( level_bits * levels ) ) - 1 );
+
+        const auto delta = target - current;
+
+        std::size_t level = 0;
+        while ( level + 1 < levels && delta >= std::uint64_t{ 1 } << ( level_bits * ( level + 1 ) ) )
+            ++level;
+
+        entry.level = static_cast< std::uint8_t >( level );
+        entry.slot = static_cast< std::uint8_t >( ( target >> ( level_bits * level ) ) & ( slots - 1 ) );
+
+        auto& head = wheel[ entry.level ][ entry.slot ];
+
+        entry.prev = npos;
+        entry.next = head;
+
+        if ( head != npos )
+            entries[ head ].prev = index;
+
+        head = index;
+    }
+
+    void scheduler::unlink( std::uint32_t index ) noexcept
+    {
+        auto& entry = entries[ index ];
+
+        if ( entry.prev != npos )
+            entries[ entry.prev ].next = entry.next;
+        else
+            wheel[ entry.level ][ entry.slot ] = entry.next;
+
+        if ( entry.next != npos )
+            entries[ entry.next ].prev = entry.prev;
+
+        entry.prev = entry.next = npos;
+    }
+
+    void scheduler::arm( std::uint32_t index, clock::time_point from, clock::duration delay ) noexcept
+    {
+        auto& entry = entries[ index ];
+
+        entry.deadline = from + delay;
+
+        const auto ticks = ( entry.deadline - start + options.resolution - clock::duration( 1 ) ) / options.resolution;
+        entry.expires = static_cast< std::uint64_t >( std::max< decltype( ticks ) >( ticks, 0 ) );
+
+        link( index );
+    }
+
+    scheduler::clock::duration scheduler::jittered_interval() noexcept
+    {
+        return std::chrono::duration_cast< clock::duration >(
+            options.interval * ( 1.0 + std::uniform_real_distribution( -options.jitter, options.jitter )( random ) ) );
+    }
+
+    bool scheduler::is_rejection( const error& err ) noexcept
+    {
+        return err == error_code_t::unauthorized_t || err == error_code_t::app_not_found_t || err == error_code_t::app_paused_t ||
+               err == error_code_t::hash_unauthorized_t;
+    }
+
+    void scheduler::advance( clock::time_point now, std::vector< id_t >& due ) noexcept
+    {
+        ++current;
+
+        // When a level wraps around, the next slot of the level above is cascaded into the levels below it.
+        for ( std::size_t level = 1; level < levels; ++level )
+        {
+            if ( ( current & ( ( std::uint64_t{ 1 } << ( level_bits * level ) ) - 1 ) ) != 0 )
+                break;
+
+            const auto slot = ( current >> ( level_bits * level ) ) & ( slots - 1 );
+
+            auto index = std::exchange( wheel[ level ][ slot ], npos );
+
+            while ( index != npos )
+            {
+                const auto next = entries[ index ].next;
+                link( index );
+                index = next;
+            }
+        }
+
+        auto index = std::exchange( wheel[ 0 ][ current & ( slots - 1 ) ], npos );
+
+        while ( index != npos )
+        {
+            auto& entry = entries[ index ];
+            const auto next = entry.next;
+
+            entry.prev = entry.next = npos;
+            entry.state = state_t::running;
+
+            try
+            {
+                due.push_back( static_cast< id_t >( entry.generation ) << 32 | index );
+            }
+            catch ( const std::exception& )
+            {
+                // Keep the session scheduled rather than losing it.
+                entry.state = state_t::armed;
+                arm( index, now, std::chrono::duration_cast< clock::duration >( options.interval ) );
+            }
+
+            index = next;
+        }
+    }
+
+    void scheduler::release( std::uint32_t index ) noexcept
+    {
+        auto& entry = entries[ index ];
+
+        entry.session.reset();
+        entry.callback = nullptr;
+        entry.state = state_t::free;
+
+        // Bumping the generation invalidates every ID that still refers to this entry.
+        ++entry.generation;
+
+        entry.next = free_list;
+        free_list = index;
+    }
+
+    scheduler::entry_t* scheduler::find( id_t id ) noexcept
+    {
+        const auto index = static_cast< std::uint32_t >( id );
+        const auto generation = static_cast< std::uint32_t >( id >> 32 );
+
+        if ( index >= entries.size() )
+            return nullptr;
+
+        auto& entry = entries[ index ];
+
+        if ( entry.generation != generation || entry.state == state_t::free )
+            return nullptr;
+
+        return &entry;
+    }
+}  // namespace tsar
@@ -1,8 +1,101 @@
 #include "system.hpp"
 
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#if defined _WIN32 || defined _WIN64 || defined __CYGWIN__
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
 namespace tsar::system
 {
-    std::optional< std::string > hwid() noexcept
+    namespace
+    {
+        /// <summary>
+        /// The hash of the executable, computed once per process.
+        /// </summary>
+        struct executable_hash_t
+        {
+            std::once_flag started, measured;
+            std::shared_future< std::string > value;
+
+            /// <summary>
+            /// The hash found in the hash cache by the first request, used until the full hash is ready.
+            /// </summary>
+            std::string cached_hash;
+
+            /// <summary>
+            /// The hash cache, enabled through enable_hash_cache, and the full hash it is updated with. Guarded by the cache mutex.
+            /// </summary>
+            std::mutex cache_mutex;
+            std::optional< std::filesystem::path > cache_path;
+            std::string cache_secret, cache_key;
+            std::optional< std::string > full_hash;
+            bool cache_stored = false;
+
+            hash_status_t status{};
+            std::atomic< bool > has_status{ false };
+        };
+
+        executable_hash_t& executable_hash() noexcept
+        {
+            static executable_hash_t hash;
+            return hash;
+        }
+
+        /// <summary>
+        /// The two hexadecimal digits of every byte value.
+        /// </summary>
+        constexpr auto hex_table = []
+        {
+            constexpr char digits[] = "0123456789abcdef";
+
+            std::array< std::array< char, 2 >, 256 > table{};
+            for ( std::size_t i = 0; i < table.size(); ++i )
+                table[ i ] = { digits[ i >> 4 ], digits[ i & 0xf ] };
+
+            return table;
+        }();
+
+        std::string to_hex( const unsigned char* data, const std::size_t size )
+        {
+            std::string hex( size * 2, '\0' );
+
+            for ( std::size_t i = 0; i < size; ++i )
+                std::memcpy( hex.data() + i * 2, hex_table[ data[ i ] ].data(), 2 );
+
+            return hex;
+        }
+    }  // namespace
+
+#if defined _WIN32 || defined _WIN64 || defined __CYGWIN__
+    /// <summary>
+    /// Reads the machine GUID that Windows generates on installation.
+    /// </summary>
+    static std::optional< std::string > read_hwid() noexcept
     {
         char szBuffer[ BUFSIZ ]{};
         DWORD dwSize = sizeof( szBuffer );
@@ -10,41 +103,742 @@ namespace tsar::system
         if ( RegGetValue( HKEY_LOCAL_MACHINE, "SOFTWARE\\Microsoft\\Cryptography", "MachineGuid", RRF_RT_REG_SZ, NULL, szBuffer, &dwSize ) )
             return std::nullopt;
 
-        return std::string( szBuffer, dwSize );
+        // The size includes the terminating null character.
+        return std::string( szBuffer, dwSize ? dwSize - 1 : 0 );
     }
 
     bool open_browser( const std::string_view url ) noexcept
     {
         return reinterpret_cast< std::uintptr_t >( ShellExecute( NULL, "open", url.data(), NULL, NULL, SW_SHOWNORMAL ) ) > 32;
     }
+#else
+    /// <summary>
+    /// Reads a small file from procfs, sysfs or /etc, without the trailing whitespace. Empty if the file cannot be read.
+    /// </summary>
+    static std::string read_identifier( const char* path ) noexcept
+    {
+        const auto file = open( path, O_RDONLY | O_CLOEXEC );
+
+        if ( file < 0 )
+            return {};
+
+        char buffer[ 256 ];
+        ssize_t size;
+        do
+            size = read( file, buffer, sizeof( buffer ) );
+        while ( size < 0 && errno == EINTR );
+
+        close( file );
+
+        if ( size <= 0 )
+            return {};
+
+        std::string_view value( buffer, static_cast< std::size_t >( size ) );
+        while ( !value.empty() && std::isspace( static_cast< unsigned char >( value.back() ) ) )
+            value.remove_suffix( 1 );
+
+        return std::string( value );
+    }
+
+    /// <summary>
+    /// Derives a fingerprint from the machine ID of systemd/D-Bus and the DMI identifiers of the board. Only identifiers that every user
+    /// can read are used, so the fingerprint does not depend on whether the process runs as root. It is formatted like a GUID, the same as
+    /// the machine GUID on Windows.
+    /// </summary>
+    static std::optional< std::string > read_hwid() noexcept
+    {
+        auto machine_id = read_identifier( "/etc/machine-id" );
+
+        if ( machine_id.empty() )
+            machine_id = read_identifier( "/var/lib/dbus/machine-id" );
+
+        static constexpr const char* dmi_paths[] = {
+            "/sys/class/dmi/id/sys_vendor",
+            "/sys/class/dmi/id/product_name",
+            "/sys/class/dmi/id/board_vendor",
+            "/sys/class/dmi/id/board_name",
+        };
+
+        try
+        {
+            auto identity = machine_id;
+            auto has_dmi = false;
+
+            for ( const auto path : dmi_paths )
+            {
+                const auto value = read_identifier( path );
+                has_dmi |= !value.empty();
+
+                identity += '\n';
+                identity += value;
+            }
+
+            if ( machine_id.empty() && !has_dmi )
+                return std::nullopt;
+
+            unsigned char hash[ EVP_MAX_MD_SIZE ];
+            unsigned int size = 0;
+
+            if ( !EVP_Digest( identity.data(), identity.size(), hash, &size, EVP_sha256(), nullptr ) || size < 16 )
+                return std::nullopt;
+
+            const auto hex = to_hex( hash, 16 );
+            return std::format( "{}-{}-{}-{}-{}", hex.substr( 0, 8 ), hex.substr( 8, 4 ), hex.substr( 12, 4 ), hex.substr( 16, 4 ), hex.substr( 20 ) );
+        }
+        catch ( const std::exception& )
+        {
+            return std::nullopt;
+        }
+    }
+
+    bool open_browser( const std::string_view url ) noexcept
+    {
+        try
+        {
+#ifdef __APPLE__
+            const char* opener = "open";
+#else
+            const char* opener = "xdg-open";
+#endif
+            std::string target( url );
+            char* const argv[] = { const_cast< char* >( opener ), target.data(), nullptr };
+
+            pid_t process;
+            if ( posix_spawnp( &process, opener, nullptr, nullptr, argv, environ ) != 0 )
+                return false;
+
+            int status;
+            while ( waitpid( process, &status, 0 ) < 0 )
+            {
+                if ( errno != EINTR )
+                    return false;
+            }
+
+            return WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+        }
+        catch ( const std::exception& )
+        {
+            return false;
+        }
+    }
+#endif
+
+    const std::optional< std::string >& hwid() noexcept
+    {
+        // Read once; every later call only returns the cached value.
+        static const auto value = read_hwid();
+        return value;
+    }
+
+    namespace
+    {
+        /// <summary>
+        /// Hashes a file through its read calls, for when it cannot be mapped.
+        /// </summary>
+        template < typename Read >
+        bool digest_stream( EVP_MD_CTX* context, Read&& read )
+        {
+            std::vector< unsigned char > buffer( 1024 * 1024 );
+
+            for ( ;; )
+            {
+                const auto size = read( buffer.data(), buffer.size() );
+
+                if ( size < 0 )
+                    return false;
+
+                if ( size == 0 )
+                    return true;
+
+                if ( !EVP_DigestUpdate( context, buffer.data(), static_cast< std::size_t >( size ) ) )
+                    return false;
+            }
+        }
+
+        /// <summary>
+        /// The executable file of the process, or any other file that is hashed the same way, opened and mapped into memory for reading.
+        /// </summary>
+        class executable_t final
+        {
+           public:
+            executable_t() noexcept;
+
+            /// <summary>
+            /// Opens a file. If `map` is false, the file is not mapped and is read in chunks instead.
+            /// </summary>
+            explicit executable_t( const std::filesystem::path& path, bool map ) noexcept;
+
+            ~executable_t();
+
+            executable_t( const executable_t& ) = delete;
+            executable_t& operator=( const executable_t& ) = delete;
+
+            bool is_open() const noexcept;
+
+            /// <summary>
+            /// The contents of the file, or null if it could not be mapped.
+            /// </summary>
+            const unsigned char* data() const noexcept;
+            std::size_t size() const noexcept;
+
+            /// <summary>
+            /// Identifies this version of the file by its device, file ID, size and modification and change times. Replacing or
+            /// modifying the file changes its identity. Empty if the file cannot be identified.
+            /// </summary>
+            std::string identity() const;
+
+            /// <summary>
+            /// Feeds the whole file into a digest, advising the OS that it is read sequentially.
+            /// </summary>
+            bool digest( EVP_MD_CTX* context ) noexcept;
+
+           private:
+            void open( const std::filesystem::path& path, bool map ) noexcept;
+
+#if defined _WIN32 || defined _WIN64 || defined __CYGWIN__
+            HANDLE file = INVALID_HANDLE_VALUE;
+            HANDLE mapping = NULL;
+#else
+            int file = -1;
+#endif
+            void* view = nullptr;
+            std::size_t view_size = 0;
+        };
+
+#if defined _WIN32 || defined _WIN64 || defined __CYGWIN__
+        executable_t::executable_t() noexcept
+        {
+            try
+            {
+                std::wstring path( MAX_PATH, L'\0' );
+
+                for ( ;; )
+                {
+                    const auto size = GetModuleFileNameW( NULL, path.data(), static_cast< DWORD >( path.size() ) );
+
+                    if ( size == 0 )
+                        return;
+
+                    if ( size < path.size() )
+                    {
+                        path.resize( size );
+                        break;
+                    }
+
+                    path.resize( path.size() * 2 );
+                }
+
+                open( path, true );
+            }
+            catch ( const std::exception& )
+            {
+            }
+        }
+
+        executable_t::executable_t( const std::filesystem::path& path, bool map ) noexcept
+        {
+            open( path, map );
+        }
+
+        void executable_t::open( const std::filesystem::path& path, bool map ) noexcept
+        {
+            file = CreateFileW( path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+
+            LARGE_INTEGER size{};
+
+            if ( !map || file == INVALID_HANDLE_VALUE || !GetFileSizeEx( file, &size ) || size.QuadPart <= 0 )
+                return;
+
+            mapping = CreateFileMappingW( file, NULL, PAGE_READONLY, 0, 0, NULL );
+            view = mapping ? MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) : NULL;
+            view_size = view ? static_cast< std::size_t >( size.QuadPart ) : 0;
+        }
+
+        executable_t::~executable_t()
+        {
+            if ( view )
+                UnmapViewOfFile( view );
+
+            if ( mapping )
+                CloseHandle( mapping );
+
+            if ( file != INVALID_HANDLE_VALUE )
+                CloseHandle( file );
+        }
+
+        bool executable_t::is_open() const noexcept
+        {
+            return file != INVALID_HANDLE_VALUE;
+        }
+
+        std::string executable_t::identity() const
+        {
+            BY_HANDLE_FILE_INFORMATION info{};
+            FILE_BASIC_INFO times{};
+
+            if ( !is_open() || !GetFileInformationByHandle( file, &info ) || !GetFileInformationByHandleEx( file, FileBasicInfo, &times, sizeof( times ) ) )
+                return {};
+
+            return std::format( "{:x}:{:x}{:08x}:{:x}{:08x}:{:x}:{:x}", info.dwVolumeSerialNumber, info.nFileIndexHigh, info.nFileIndexLow, info.nFileSizeHigh,
+                                info.nFileSizeLow, times.LastWriteTime.QuadPart, times.ChangeTime.QuadPart );
+        }
+
+        bool executable_t::digest( EVP_MD_CTX* context ) noexcept
+        {
+            // The file was opened with FILE_FLAG_SEQUENTIAL_SCAN, which makes the cache manager read ahead aggressively.
+            if ( view )
+                return EVP_DigestUpdate( context, view, view_size );
+
+            if ( !is_open() )
+                return false;
+
+            try
+            {
+                return digest_stream( context, [ this ]( unsigned char* buffer, std::size_t capacity ) -> long long
+                {
+                    DWORD read = 0;
+                    return ReadFile( file, buffer, static_cast< DWORD >( capacity ), &read, NULL ) ? read : -1;
+                } );
+            }
+            catch ( const std::exception& )
+            {
+                return false;
+            }
+        }
+#else
+        executable_t::executable_t() noexcept
+        {
+            open( "/proc/self/exe", true );
+        }
+
+        executable_t::executable_t( const std::filesystem::path& path, bool map ) noexcept
+        {
+            open( path, map );
+        }
+
+        void executable_t::open( const std::filesystem::path& path, bool map ) noexcept
+        {
+            file = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+
+            struct stat info{};
+
+            if ( !map || file < 0 || fstat( file, &info ) != 0 || info.st_size <= 0 )
+                return;
+
+            const auto size = static_cast< std::size_t >( info.st_size );
+            const auto mapped = mmap( nullptr, size, PROT_READ, MAP_PRIVATE, file, 0 );
+
+            if ( mapped != MAP_FAILED )
+            {
+                view = mapped;
+                view_size = size;
+            }
+        }
+
+        executable_t::~executable_t()
+        {
+            if ( view )
+                munmap( view, view_size );
+
+            if ( file >= 0 )
+                close( file );
+        }
+
+        bool executable_t::is_open() const noexcept
+        {
+            return file >= 0;
+        }
+
+        std::string executable_t::identity() const
+        {
+            struct stat info{};
+
+            if ( !is_open() || fstat( file, &info ) != 0 )
+                return {};
+
+            return std::format( "{:x}:{:x}:{:x}:{:x}.{:x}:{:x}.{:x}", info.st_dev, info.st_ino, info.st_size, info.st_mtim.tv_sec, info.st_mtim.tv_nsec,
+                                info.st_ctim.tv_sec, info.st_ctim.tv_nsec );
+        }
+
+        bool executable_t::digest( EVP_MD_CTX* context ) noexcept
+        {
+            if ( view )
+            {
+                // The whole file is read once from start to end.
+                madvise( view, view_size, MADV_SEQUENTIAL );
+                madvise( view, view_size, MADV_WILLNEED );
+
+                return EVP_DigestUpdate( context, view, view_size );
+            }
+
+            if ( !is_open() )
+                return false;
+
+            posix_fadvise( file, 0, 0, POSIX_FADV_SEQUENTIAL );
+
+            try
+            {
+                return digest_stream( context, [ this ]( unsigned char* buffer, std::size_t capacity ) -> long long
+                {
+                    ssize_t result;
+                    do
+                        result = read( file, buffer, capacity );
+                    while ( result < 0 && errno == EINTR );
+
+                    return result;
+                } );
+            }
+            catch ( const std::exception& )
+            {
+                return false;
+            }
+        }
+#endif
+
+        const unsigned char* executable_t::data() const noexcept
+        {
+            return static_cast< const unsigned char* >( view );
+        }
+
+        std::size_t executable_t::size() const noexcept
+        {
+            return view_size;
+        }
+
+        /// <summary>
+        /// Builds the key of the executable in the hash cache from its identity. Empty if the file cannot be identified.
+        /// </summary>
+        std::string cache_key( const executable_t& executable )
+        {
+            auto identity = executable.identity();
+
+            if ( identity.empty() )
+                return {};
+
+            return std::format( "v2:{}", identity );
+        }
+
+        /// <summary>
+        /// Authenticates an entry of the hash cache with HMAC-SHA256, keyed by the secret the cache was enabled with. Without the secret,
+        /// an entry cannot be forged to make a modified executable report the hash of the original.
+        /// </summary>
+        std::string cache_mac( const std::string_view secret, const std::string& key, const std::string& hash )
+        {
+            const auto message = std::format( "{} {}", key, hash );
+
+            unsigned char mac[ EVP_MAX_MD_SIZE ];
+            unsigned int size = 0;
+
+            if ( !HMAC( EVP_sha256(), secret.data(), static_cast< int >( secret.size() ), reinterpret_cast< const unsigned char* >( message.data() ),
+                        message.size(), mac, &size ) )
+                return {};
+
+            return to_hex( mac, size );
+        }
+
+        /// <summary>
+        /// An entry of the hash cache: the key of an executable, its hash, and the MAC of both.
+        /// </summary>
+        struct cache_entry_t
+        {
+            std::string key, hash, mac;
+        };
+
+        /// <summary>
+        /// The maximum number of executables remembered by the hash cache.
+        /// </summary>
+        constexpr std::size_t cache_entries = 8;
+
+        /// <summary>
+        /// Reads the entries of the hash cache. Each line holds a key, the hash of the executable it identifies and their MAC.
+        /// </summary>
+        std::vector< cache_entry_t > read_cache( const std::filesystem::path& path )
+        {
+            std::vector< cache_entry_t > entries;
+            std::ifstream file( path );
+
+            for ( cache_entry_t entry; entries.size() < cache_entries && file >> entry.key >> entry.hash >> entry.mac; )
+            {
+                if ( entry.hash.size() == 64 && entry.hash.find_first_not_of( "0123456789abcdef" ) == std::string::npos )
+                    entries.push_back( std::move( entry ) );
+            }
+
+            return entries;
+        }
+
+        /// <summary>
+        /// Puts the hash of an executable at the front of the hash cache. The cache is written to a temporary file that replaces it, so
+        /// that concurrent launches never see a partial cache.
+        /// </summary>
+        void write_cache( const std::filesystem::path& path, cache_entry_t entry )
+        {
+            auto entries = read_cache( path );
+            std::erase_if( entries, [ &entry ]( const auto& other ) { return other.key == entry.key; } );
+            entries.insert( entries.begin(), std::move( entry ) );
+
+            auto temporary = path;
+            temporary += std::format( ".{:x}", std::chrono::steady_clock::now().time_since_epoch().count() );
+
+            {
+                std::ofstream file( temporary, std::ios::trunc );
+
+                for ( std::size_t i = 0; i < entries.size() && i < cache_entries; ++i )
+                    file << entries[ i ].key << ' ' << entries[ i ].hash << ' ' << entries[ i ].mac << '\n';
+
+                if ( !file.flush() )
+                {
+                    file.close();
+                    std::filesystem::remove( temporary );
+                    return;
+                }
+            }
+
+            std::error_code error;
+            std::filesystem::rename( temporary, path, error );
+
+            if ( error )
+                std::filesystem::remove( temporary, error );
+        }
+
+        /// <summary>
+        /// Looks up the executable in the hash cache, if it is enabled. Entries whose MAC does not match are ignored. Must be called with
+        /// the cache mutex held.
+        /// </summary>
+        std::optional< std::string > lookup_cache( const executable_hash_t& hash )
+        {
+            if ( !hash.cache_path )
+                return std::nullopt;
+
+            const executable_t executable;
+            const auto key = cache_key( executable );
+
+            if ( key.empty() )
+                return std::nullopt;
+
+            for ( auto& entry : read_cache( *hash.cache_path ) )
+            {
+                if ( entry.key != key )
+                    continue;
+
+                const auto mac = cache_mac( hash.cache_secret, entry.key, entry.hash );
+
+                if ( mac.size() == entry.mac.size() && CRYPTO_memcmp( mac.data(), entry.mac.data(), mac.size() ) == 0 )
+                    return std::move( entry.hash );
+
+                return std::nullopt;
+            }
+
+            return std::nullopt;
+        }
+
+        /// <summary>
+        /// Stores the full hash of the executable in the hash cache, once both the hash is computed and the cache is enabled. An entry that
+        /// disagrees with the full hash is replaced. Must be called with the cache mutex held.
+        /// </summary>
+        void store_cache( executable_hash_t& hash ) noexcept
+        {
+            if ( hash.cache_stored || !hash.cache_path || !hash.full_hash || hash.full_hash->empty() || hash.cache_key.empty() )
+                return;
+
+            hash.cache_stored = true;
+
+            try
+            {
+                auto mac = cache_mac( hash.cache_secret, hash.cache_key, *hash.full_hash );
+
+                if ( !mac.empty() )
+                    write_cache( *hash.cache_path, { hash.cache_key, *hash.full_hash, std::move( mac ) } );
+            }
+            catch ( const std::exception& )
+            {
+                // The cache is only an optimization.
+            }
+        }
+    }  // namespace
+
+    /// <summary>
+    /// Hashes a file with SHA-256. The digest goes through the EVP interface, so OpenSSL picks the fastest implementation for the CPU, such
+    /// as the SHA extensions on x86 and the cryptography extensions on ARMv8.
+    /// </summary>
+    /// <param name="complete">Set to whether the whole file was read. A file that cannot be read is hashed as far as it was read.</param>
+    /// <returns>The hash as a hexadecimal string, or an empty string if the digest failed.</returns>
+    static std::string sha256( executable_t& file, bool& complete )
+    {
+        unsigned char hash[ EVP_MAX_MD_SIZE ];
+        unsigned int size = 0;
+
+        const std::unique_ptr< EVP_MD_CTX, decltype( &EVP_MD_CTX_free ) > context( EVP_MD_CTX_new(), EVP_MD_CTX_free );
+
+        if ( !context || !EVP_DigestInit_ex( context.get(), EVP_sha256(), nullptr ) )
+            return {};
+
+        complete = file.digest( context.get() );
+
+        if ( !EVP_DigestFinal_ex( context.get(), hash, &size ) )
+            return {};
+
+        return to_hex( hash, size );
+    }
 
-    std::string get_hash() noexcept
+    /// <summary>
+    /// Hashes the executable. The whole file is always hashed, a cached hash only answers the requests that come before this one is done.
+    /// </summary>
+    static std::string compute_hash() noexcept
     {
-        char path[MAX_PATH];
-        GetModuleFileNameA(NULL, path, MAX_PATH);
+        try
+        {
+            executable_t executable;
 
-        std::string current_exe(path);
+            // The key is taken from the file that is hashed, so the stored entry always describes the bytes the hash was computed from.
+            auto key = cache_key( executable );
 
+            // A file that cannot be read is hashed as far as it was read, like it always has been. The server rejects the hash either way.
+            bool complete = false;
+            auto hex = sha256( executable, complete );
 
-        unsigned char hash[SHA256_DIGEST_LENGTH];
-        SHA256_CTX sha256;
-        SHA256_Init(&sha256);
-        
-        std::ifstream file(current_exe, std::ifstream::binary);
+            if ( hex.empty() )
+                return {};
 
-        const size_t bufferSize = 32768;
-        std::vector<char> buffer(bufferSize);
-        while (file.good()) {
-            file.read(buffer.data(), buffer.size());
-            SHA256_Update(&sha256, buffer.data(), file.gcount());
+            if ( complete )
+            {
+                auto& shared = executable_hash();
+
+                const std::lock_guard lock( shared.cache_mutex );
+                shared.full_hash = hex;
+                shared.cache_key = std::move( key );
+                store_cache( shared );
+            }
+
+            return hex;
+        }
+        catch ( const std::exception& )
+        {
+            return {};
         }
-        
-        SHA256_Final(hash, &sha256);
+    }
+
+    std::string hash_file( const std::string_view path, bool mapped ) noexcept
+    {
+        try
+        {
+            executable_t file( std::filesystem::path( path ), mapped );
+
+            bool complete = false;
+            auto hex = sha256( file, complete );
+
+            return complete ? hex : std::string{};
+        }
+        catch ( const std::exception& )
+        {
+            return {};
+        }
+    }
+
+    void enable_hash_cache( const std::string_view path, const std::string_view secret ) noexcept
+    {
+        if ( path.empty() || secret.empty() )
+            return;
+
+        auto& hash = executable_hash();
+
+        try
+        {
+            std::filesystem::path cache( path );
+            std::error_code error;
+
+            if ( std::filesystem::is_directory( cache, error ) )
+                cache /= "tsar-hash-cache";
 
-        std::stringstream ss;
-        for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i) {
-            ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(hash[i]);
+            const std::lock_guard lock( hash.cache_mutex );
+
+            if ( hash.cache_path )
+                return;
+
+            hash.cache_path = std::move( cache );
+            hash.cache_secret = secret;
+
+            // If the hash was computed before the cache was enabled, it is stored right away.
+            store_cache( hash );
+        }
+        catch ( const std::exception& )
+        {
         }
-        return ss.str();
     }
+
+    void precompute_hash() noexcept
+    {
+        auto& hash = executable_hash();
+
+        std::call_once( hash.started, [ &hash ]
+        {
+            try
+            {
+                hash.value = std::async( std::launch::async, compute_hash ).share();
+            }
+            catch ( const std::exception& )
+            {
+                // Without a thread, the hash is computed by the first request that needs it.
+                hash.value = std::async( std::launch::deferred, compute_hash ).share();
+            }
+        } );
+    }
+
+    const std::string& get_hash() noexcept
+    {
+        auto& hash = executable_hash();
+        precompute_hash();
+
+        std::call_once( hash.measured, [ &hash ]
+        {
+            const auto start = std::chrono::steady_clock::now();
+
+            hash.status.ready = hash.value.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready;
+
+            // Only a request that would otherwise wait for the full hash looks in the cache.
+            if ( !hash.status.ready )
+            {
+                try
+                {
+                    const std::lock_guard lock( hash.cache_mutex );
+
+                    if ( auto cached = lookup_cache( hash ) )
+                    {
+                        hash.cached_hash = std::move( *cached );
+                        hash.status.cached = true;
+                    }
+                }
+                catch ( const std::exception& )
+                {
+                }
+            }
+
+            if ( !hash.status.cached )
+                hash.value.wait();
+
+            hash.status.wait = std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now() - start );
+            hash.has_status.store( true, std::memory_order_release );
+        } );
+
+        // The cached hash is only used until the full hash is ready, which replaces it even if the cache was stale.
+        if ( hash.status.cached && hash.value.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+            return hash.cached_hash;
+
+        return hash.value.get();
+    }
+
+    std::optional< hash_status_t > hash_status() noexcept
+    {
+        const auto& hash = executable_hash();
+
+        if ( !hash.has_status.load( std::memory_order_acquire ) )
+            return std::nullopt;
+
+        return hash.status;
+    }
+
+    namespace
+    {
+        // Starts hashing the executable as soon as the SDK is loaded, so that the first request usually finds the hash ready.
+        [[maybe_unused]] const auto precomputed = ( precompute_hash(), true );
+    }  // namespace
 }  // namespace tsar::system
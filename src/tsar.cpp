@@ -1,59 +1,390 @@
 #include "tsar.hpp"
 
 #include <curl/curl.h>
-#include <openssl/x509.h>
 
+#include <charconv>
+#include <cstdlib>
 #include <format>
+#include <future>
 #include <iostream>
+#include <thread>
 
 #include "base64.hpp"
+#include "http/arena.hpp"
+#include "http/engine.hpp"
 #include "system.hpp"
 
-constexpr auto app_id_size = 36;
-constexpr auto client_key_size = 124;
+namespace tsar
+{
+    /// <summary>
+    /// The data of the response to the initialization request.
+    /// </summary>
+    struct initialize_t
+    {
+        std::string dashboard_hostname;
+    };
+}  // namespace tsar
+
+namespace tsar::decode
+{
+    template<>
+    struct descriptor_t< initialize_t >
+    {
+        static constexpr auto fields = std::make_tuple( field( "dashboard_hostname", &initialize_t::dashboard_hostname ) );
+    };
+}  // namespace tsar::decode
 
 namespace tsar
 {
-    ntp::client client::ntp{ "time.cloudflare.com", 123 };
+    /// <summary>
+    /// Gets the value of an environment variable, or the fallback if it is not set.
+    /// </summary>
+    static std::string_view environment( const char* name, const std::string_view fallback ) noexcept
+    {
+        const auto value = std::getenv( name );
+        return value && *value ? value : fallback;
+    }
 
-    static size_t write_callback( void* ptr, size_t size, size_t nmemb, std::string* data )
+    /// <summary>
+    /// Splits an NTP server in host[:port] format.
+    /// </summary>
+    static std::pair< std::string_view, std::uint16_t > parse_ntp_server( const std::string_view server ) noexcept
     {
-        data->append( ( char* )ptr, size * nmemb );
-        return size * nmemb;
+        const auto separator = server.rfind( ':' );
+
+        std::uint16_t port = 123;
+
+        if ( separator == std::string_view::npos ||
+             std::from_chars( server.data() + separator + 1, server.data() + server.size(), port ).ec != std::errc{} )
+            return { server, 123 };
+
+        return { server.substr( 0, separator ), port };
     }
 
-    result_t< nlohmann::json > client::api_call( const std::string_view key, const std::string_view endpoint ) noexcept
+    /// <summary>
+    /// Creates the NTP client for the servers in the TSAR_NTP_SERVER environment variable, a comma-separated list in host[:port] format.
+    /// </summary>
+    static ntp::client default_ntp_client()
     {
-        const auto hwid = system::hwid();
-        const auto hash = system::get_hash();
+        std::vector< std::pair< std::string_view, std::uint16_t > > servers;
 
+        for ( auto list = environment( "TSAR_NTP_SERVER", "time.cloudflare.com,time.google.com" ); !list.empty(); )
+        {
+            const auto separator = std::min( list.find( ',' ), list.size() );
 
-        if ( !hwid )
-            return std::unexpected( error( error_code_t::failed_to_get_hwid_t ) );
+            if ( separator )
+                servers.push_back( parse_ntp_server( list.substr( 0, separator ) ) );
 
-        const auto curl = curl_easy_init();
+            list.remove_prefix( std::min( separator + 1, list.size() ) );
+        }
 
-        if ( !curl )
-            return std::unexpected( error( error_code_t::unexpected_error_t ) );
+        if ( servers.empty() )
+            servers.emplace_back( "time.cloudflare.com", 123 );
+
+        return ntp::client( servers );
+    }
+
+    std::string client::api_url{ environment( "TSAR_API_URL", client::default_api_url ) };
+    ntp::client client::ntp = default_ntp_client();
+
+    void client::set_api_url( const std::string_view url )
+    {
+        api_url = url;
+    }
+
+    void client::set_ntp_server( const std::string_view host, std::uint16_t port )
+    {
+        ntp.set_server( host, port );
+    }
+
+    void client::add_ntp_server( const std::string_view host, std::uint16_t port )
+    {
+        ntp.add_server( host, port );
+    }
+
+    void client::set_ntp_refresh_interval( std::chrono::seconds interval )
+    {
+        ntp.set_refresh_interval( interval );
+    }
+
+    void client::set_ntp_source( ntp::client::source_t source, std::chrono::milliseconds tolerance )
+    {
+        ntp.set_source( source, tolerance );
+    }
 
-        auto formatted = std::format( "{}/{}", api_url, endpoint );
+    /// <summary>
+    /// The fields of a payload that are checked on every response.
+    /// </summary>
+    struct payload_fields_t
+    {
+        std::optional< std::string_view > hwid;
+        bool hwid_escaped = false;
+        std::optional< std::uint64_t > timestamp;
+    };
+
+    /// <summary>
+    /// Reads the top-level `hwid` and `timestamp` fields of a payload without building a DOM. Other values are only checked for balanced
+    /// nesting, the payload is verified against its signature anyway.
+    /// </summary>
+    /// <returns>False if the payload is not a JSON object.</returns>
+    static bool scan_payload( const std::string_view json, payload_fields_t& fields ) noexcept
+    {
+        std::size_t i = 0;
 
-        // Add the HWID to the endpoint.
-        formatted.append( std::format( "&hash={}", hash ) );
-        formatted.append( std::format( "&hwid={}", *hwid ) );
+        const auto skip_whitespace = [ & ]
+        {
+            while ( i < json.size() && ( json[ i ] == ' ' || json[ i ] == '\t' || json[ i ] == '\n' || json[ i ] == '\r' ) )
+                ++i;
+        };
 
+        // Reads the raw contents of the string that starts at the current quote.
+        const auto read_string = [ & ]( std::string_view& value, bool& escaped )
+        {
+            const auto start = ++i;
+            escaped = false;
 
-        curl_easy_setopt( curl, CURLOPT_URL, formatted.c_str() );
+            for ( ; i < json.size() && json[ i ] != '"'; ++i )
+            {
+                if ( json[ i ] == '\\' )
+                {
+                    escaped = true;
+                    ++i;
+                }
+            }
+
+            if ( i >= json.size() )
+                return false;
 
-        std::string response;
-        curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, write_callback );
-        curl_easy_setopt( curl, CURLOPT_WRITEDATA, &response );
+            value = json.substr( start, i++ - start );
+            return true;
+        };
+
+        skip_whitespace();
+
+        if ( i >= json.size() || json[ i++ ] != '{' )
+            return false;
+
+        skip_whitespace();
+
+        if ( i < json.size() && json[ i ] == '}' )
+            ++i;
+        else
+        {
+            while ( true )
+            {
+                std::string_view key, value;
+                bool key_escaped = false, value_escaped = false;
+
+                skip_whitespace();
+
+                if ( i >= json.size() || json[ i ] != '"' || !read_string( key, key_escaped ) )
+                    return false;
+
+                skip_whitespace();
+
+                if ( i >= json.size() || json[ i++ ] != ':' )
+                    return false;
+
+                skip_whitespace();
+
+                if ( i >= json.size() )
+                    return false;
+
+                const auto is_string = json[ i ] == '"';
+
+                if ( is_string )
+                {
+                    if ( !read_string( value, value_escaped ) )
+                        return false;
+                }
+                else
+                {
+                    const auto start = i;
+                    std::size_t depth = 0;
+
+                    while ( i < json.size() )
+                    {
+                        const auto c = json[ i ];
+
+                        if ( c == '"' )
+                        {
+                            if ( !read_string( value, value_escaped ) )
+                                return false;
+
+                            continue;
+                        }
+
+                        if ( c == '{' || c == '[' )
+                            ++depth;
+                        else if ( c == '}' || c == ']' )
+                        {
+                            // A closing brace at the top level ends a scalar and belongs to the payload itself.
+                            if ( depth == 0 )
+                                break;
+
+                            if ( --depth == 0 )
+                            {
+                                ++i;
+                                break;
+                            }
+                        }
+                        else if ( depth == 0 && ( c == ',' || c == ' ' || c == '\t' || c == '\n' || c == '\r' ) )
+                            break;
+
+                        ++i;
+                    }
+
+                    if ( depth != 0 )
+                        return false;
+
+                    value = json.substr( start, i - start );
+                }
+
+                // Like a DOM, a repeated key replaces the previous value.
+                if ( !key_escaped && key == "hwid" )
+                {
+                    fields.hwid = is_string ? std::optional( value ) : std::nullopt;
+                    fields.hwid_escaped = value_escaped;
+                }
+                else if ( !key_escaped && key == "timestamp" )
+                {
+                    // Only a plain non-negative integer counts as an unsigned number.
+                    std::uint64_t timestamp = 0;
+
+                    const auto digits = !is_string && !value.empty() && value.find_first_not_of( "0123456789" ) == std::string_view::npos;
+                    const auto parsed = digits && std::from_chars( value.data(), value.data() + value.size(), timestamp ).ec == std::errc{};
+
+                    fields.timestamp = parsed ? std::optional( timestamp ) : std::nullopt;
+                }
+
+                skip_whitespace();
+
+                if ( i < json.size() && json[ i ] == ',' )
+                {
+                    ++i;
+                    continue;
+                }
+
+                if ( i < json.size() && json[ i ] == '}' )
+                {
+                    ++i;
+                    break;
+                }
+
+                return false;
+            }
+        }
+
+        skip_whitespace();
+        return i == json.size();
+    }
+
+    /// <summary>
+    /// Gets the endpoint of a request URL, i.e. the last segment of its path.
+    /// </summary>
+    static std::string_view endpoint_of( const std::string_view url ) noexcept
+    {
+        const auto path = url.substr( 0, url.find( '?' ) );
+        return path.substr( path.rfind( '/' ) + 1 );
+    }
+
+    std::string client::request_url( const std::string_view endpoint, const std::string_view query )
+    {
+        return std::format( "{}/{}{}", api_url, endpoint, query );
+    }
+
+    result_t< void > client::api_request(
+        http::pool& pool,
+        const crypto::key& key,
+        const std::string& url,
+        const std::string& hwid,
+        std::pmr::string& payload ) noexcept
+    {
+        // Wait for the governor, or fail right away instead of sending a request that is bound to be rate limited.
+        auto& governor = pool.governor();
+        const auto endpoint_class = http::governor::classify( endpoint_of( url ) );
+
+        const auto wait = governor.reserve( endpoint_class );
+
+        if ( !wait )
+            return std::unexpected( error( error_code_t::rate_limited_t ) );
+
+        if ( *wait > http::governor::clock::duration::zero() )
+            std::this_thread::sleep_for( *wait );
+
+        auto handle = pool.acquire();
+
+        if ( !handle )
+            return std::unexpected( error( error_code_t::unexpected_error_t ) );
+
+        const auto curl = handle.handle();
+        handle.set_url( url );
+
+        // The body is parsed while it is received, so it is never buffered as a whole.
+        http::envelope response( pool.max_response_size(), payload.get_allocator().resource() );
+        response.attach( curl );
 
         long status_code = 0;
-        if ( curl_easy_perform( curl ) == CURLE_OK )
+        if ( pool.perform( handle ) )
             curl_easy_getinfo( curl, CURLINFO_RESPONSE_CODE, &status_code );
 
-        curl_easy_cleanup( curl );
+        governor.record( endpoint_class, status_code, response.retry_after() );
+
+        return verify_response( key, hwid, status_code, response, payload );
+    }
+
+    void client::api_call_async(
+        const std::shared_ptr< http::pool >& pool,
+        crypto::key key,
+        std::string url,
+        std::string hwid,
+        std::function< void( result_t< std::string_view >&& ) > callback ) noexcept
+    {
+        if ( !pool )
+            return callback( std::unexpected( error( error_code_t::unexpected_error_t ) ) );
+
+        // A throttled request is held back by the engine rather than blocking the caller.
+        const auto endpoint_class = http::governor::classify( endpoint_of( url ) );
+        const auto wait = pool->governor().reserve( endpoint_class );
+
+        if ( !wait )
+            return callback( std::unexpected( error( error_code_t::rate_limited_t ) ) );
+
+        try
+        {
+            auto completion = [ pool, endpoint_class, key = std::move( key ), hwid = std::move( hwid ), callback ]( long status_code, http::envelope& response )
+            {
+                pool->governor().record( endpoint_class, status_code, response.retry_after() );
+
+                // Completions run one after another on the I/O thread, so they share its arena.
+                std::pmr::string payload( http::arena::local().reset() );
+
+                if ( const auto result = verify_response( key, hwid, status_code, response, payload ); !result )
+                    return callback( std::unexpected( result.error() ) );
+
+                callback( std::string_view( payload ) );
+            };
+
+            if ( http::engine::get().submit( pool, std::move( url ), std::move( completion ), *wait ) )
+                return;
+        }
+        catch ( const std::exception& )
+        {
+        }
+
+        callback( std::unexpected( error( error_code_t::unexpected_error_t ) ) );
+    }
+
+    result_t< void > client::verify_response(
+        const crypto::key& key,
+        const std::string& hwid,
+        long status_code,
+        http::envelope& response,
+        std::pmr::string& payload ) noexcept
+    {
+        // The transfer was aborted on purpose, the server is not to blame.
+        if ( response.finish() == http::envelope::state_t::too_large )
+            return std::unexpected( error( error_code_t::response_too_large_t ) );
 
         // If we are unable to make a request to the server then it is likely down. No need to do any error handling here.
         if ( !status_code )
@@ -74,176 +405,165 @@ namespace tsar
             default: return std::unexpected( error( error_code_t::server_error_t ) );
         }
 
-        const auto json = nlohmann::json::parse( response, nullptr, false );
-
-        if ( json.is_discarded() )
+        if ( response.finish() != http::envelope::state_t::complete )
             return std::unexpected( error( error_code_t::failed_to_parse_body_t ) );
 
-        if ( !json.contains( "data" ) || !json[ "data" ].is_string() )
+        if ( !response.has_data() )
             return std::unexpected( error( error_code_t::failed_to_get_data_t ) );
 
-        if ( !json.contains( "signature" ) || !json[ "signature" ].is_string() )
+        if ( !response.has_signature() )
             return std::unexpected( error( error_code_t::failed_to_get_signature_t ) );
 
-        const auto signature = base64::safe_from_base64( json[ "signature" ].get< std::string >() );
+        // The signature is decoded in the buffer it was received into, the data was already decoded while it was received. The payload
+        // takes over the buffer of the data, which comes from the same memory resource for synchronous requests.
+        auto& signature = response.signature();
 
-        if ( !signature )
+        if ( !base64::try_decode_in_place( signature ) )
             return std::unexpected( error( error_code_t::failed_to_decode_signature_t ) );
 
-        const auto data = base64::safe_from_base64( json[ "data" ].get< std::string >() );
-
-        if ( !data )
+        if ( !response.data_decoded() )
             return std::unexpected( error( error_code_t::failed_to_decode_data_t ) );
 
-        const auto data_json = nlohmann::json::parse( *data, nullptr, false );
+        payload = std::move( response.data() );
+
+        payload_fields_t fields;
 
-        if ( data_json.is_discarded() )
+        if ( !scan_payload( payload, fields ) )
             return std::unexpected( error( error_code_t::failed_to_parse_body_t ) );
 
-        if ( !data_json.contains( "hwid" ) || !data_json[ "hwid" ].is_string() )
+        if ( !fields.hwid )
             return std::unexpected( error( error_code_t::failed_to_parse_data_t ) );
 
-        if ( !data_json.contains( "timestamp" ) || !data_json[ "timestamp" ].is_number_unsigned() )
+        if ( !fields.timestamp )
             return std::unexpected( error( error_code_t::failed_to_get_timestamp_t ) );
 
-        // Verify that the HWID matches the user's HWID.
-        if ( data_json[ "hwid" ].get< std::string >() != hwid->c_str() )
+        // Verify that the HWID matches the user's HWID. An escaped HWID is rare enough to be unescaped by a full parse.
+        if ( fields.hwid_escaped )
+        {
+            const auto data_json = nlohmann::json::parse( payload, nullptr, false );
+
+            if ( data_json.is_discarded() || !data_json[ "hwid" ].is_string() )
+                return std::unexpected( error( error_code_t::failed_to_parse_data_t ) );
+
+            if ( data_json[ "hwid" ].get< std::string >() != hwid.c_str() )
+                return std::unexpected( error( error_code_t::hwid_mismatch_t ) );
+        }
+        else if ( *fields.hwid != hwid.c_str() )
             return std::unexpected( error( error_code_t::hwid_mismatch_t ) );
 
-        const auto timestamp = static_cast< time_t >( data_json[ "timestamp" ].get< uint64_t >() );
-        const auto ntp_timestamp = ntp.request_time();
+        const auto timestamp = static_cast< time_t >( *fields.timestamp );
+        // The NTP time is extrapolated from the last measurement, so the check does not wait for the NTP server.
+        const auto ntp_time = ntp.now();
 
-        if ( !ntp_timestamp )
-            return std::unexpected( ntp_timestamp.error() );
+        if ( !ntp_time )
+            return std::unexpected( ntp_time.error() );
 
-        const auto system_time = std::chrono::system_clock::to_time_t( std::chrono::system_clock::now() );
+        const auto system_now = std::chrono::system_clock::now();
+        const auto system_time = std::chrono::system_clock::to_time_t( system_now );
 
-        // Calculate the duration between the NTP timestamp and the system time.
-        const auto duration = std::chrono::seconds( *ntp_timestamp > system_time ? *ntp_timestamp - system_time : system_time - *ntp_timestamp );
+        // Calculate the duration between the NTP time and the system time.
+        const auto duration = std::chrono::abs( std::chrono::duration_cast< std::chrono::seconds >( *ntp_time - system_now ) );
 
         // If the duration is greater than 30 seconds then we have a problem. The user's system time is not in sync with the NTP server.
         if ( duration > std::chrono::seconds( 30 ) || timestamp < ( system_time - 30u ) )
             return std::unexpected( error( error_code_t::old_response_t ) );
 
-        if ( !verify_signature( key, *data, *signature ) )
+        if ( !key.verify( payload, signature ) )
             return std::unexpected( error( error_code_t::invalid_signature_t ) );
 
-        return data_json;
+        return {};
     }
 
-    bool client::verify_signature( const std::string_view key, const std::string_view json, const std::string_view signature ) noexcept
+    result_t< client > client::create( const std::string_view app_id, const std::string_view client_key ) noexcept
     {
-        const std::uint8_t* data = reinterpret_cast< const std::uint8_t* >( key.data() );
-        std::size_t data_size = key.size();
-
-        // Create the EVP_PKEY structure from the public key
-        EVP_PKEY* pkey = d2i_PUBKEY( nullptr, &data, static_cast< long >( data_size ) );
-        if ( !pkey )
-            return false;
+        if ( app_id.length() != app_id_size )
+            return std::unexpected( error( error_code_t::invalid_app_id_t ) );
 
-        // Create an ECDSA_SIG structure and manually set r and s
-        ECDSA_SIG* ecdsa_sig = ECDSA_SIG_new();
-        if ( !ecdsa_sig )
-        {
-            EVP_PKEY_free( pkey );
-            return false;
-        }
+        if ( client_key.length() != client_key_size )
+            return std::unexpected( error( error_code_t::invalid_client_key_t ) );
 
-        const auto half_len = static_cast< std::int32_t >( signature.size() / 2 );
+        // The key is decoded on the stack, by the same code that decodes it at compile time.
+        const auto der = decode_client_key( client_key );
 
-        // Convert the signature components to BIGNUMs. We need to do this because the signature is in raw format.
-        const auto r = BN_bin2bn( reinterpret_cast< const std::uint8_t* >( signature.data() ), half_len, nullptr );
-        const auto s = BN_bin2bn( reinterpret_cast< const std::uint8_t* >( signature.data() + half_len ), half_len, nullptr );
+        if ( !der )
+            return std::unexpected( error( error_code_t::failed_to_decode_public_key_t ) );
 
-        if ( !r || !s )
-        {
-            ECDSA_SIG_free( ecdsa_sig );
-            EVP_PKEY_free( pkey );
-            return false;
-        }
+        return initialize( app_id, std::string_view( der->data(), der->size() ) );
+    }
 
-        ECDSA_SIG_set0( ecdsa_sig, r, s );  // ECDSA_SIG now owns r and s
+    result_t< client > client::initialize( const std::string_view app_id, const std::string_view der ) noexcept
+    {
+        // The key is only parsed once, and verifies the signatures of every response to the client.
+        auto pub_key = crypto::key::parse( der );
 
-        // Convert ECDSA_SIG to DER format
-        int der_len = i2d_ECDSA_SIG( ecdsa_sig, nullptr );
-        if ( der_len <= 0 )
-            return false;
+        if ( !pub_key )
+            return std::unexpected( error( error_code_t::failed_to_decode_public_key_t ) );
 
-        std::vector< std::uint8_t > der_sig( der_len );
-        auto der_sig_ptr = der_sig.data();
+        const auto& hwid = system::hwid();
 
-        // Now we encode the ECDSA_SIG structure into DER format
-        if ( i2d_ECDSA_SIG( ecdsa_sig, &der_sig_ptr ) != der_len )
-        {
-            ECDSA_SIG_free( ecdsa_sig );
-            EVP_PKEY_free( pkey );
-            return false;
-        }
+        if ( !hwid )
+            return std::unexpected( error( error_code_t::failed_to_get_hwid_t ) );
 
-        // Verify the signature using the DER-encoded ECDSA signature
-        EVP_MD_CTX* mdctx = EVP_MD_CTX_new();
-        if ( !mdctx )
-        {
-            ECDSA_SIG_free( ecdsa_sig );
-            EVP_PKEY_free( pkey );
-            return false;
-        }
+        // The HWID and the hash of the binary are part of every request, so their part of the query is only built once.
+        const auto query = std::format( "&hash={}&hwid={}", system::get_hash(), *hwid );
 
-        EVP_DigestVerifyInit( mdctx, nullptr, EVP_sha256(), nullptr, pkey );
-        EVP_DigestVerifyUpdate( mdctx, json.data(), json.size() );
+        // The pool is created here so that the initialization request already warms up the connection used by later requests.
+        auto pool = std::make_shared< http::pool >();
 
-        const auto result = EVP_DigestVerifyFinal( mdctx, der_sig.data(), der_len );
+        // Make the initialization request to the server.
+        auto result = api_call< initialize_t >( *pool, *pub_key, request_url( std::format( "initialize?app_id={}", app_id ), query ), *hwid );
 
-        ECDSA_SIG_free( ecdsa_sig );
-        EVP_MD_CTX_free( mdctx );
-        EVP_PKEY_free( pkey );
+        if ( !result )
+            return std::unexpected( result.error() );
 
-        return result == 1;
+        return client( app_id, std::move( *pub_key ), result->dashboard_hostname, *hwid, query, std::move( pool ) );
     }
 
-    result_t< client > client::create( const std::string_view app_id, const std::string_view client_key ) noexcept
+    result_t< user > client::authenticate( bool open ) const noexcept
     {
-        if ( app_id.length() != app_id_size )
-            return std::unexpected( error( error_code_t::invalid_app_id_t ) );
-
-        if ( client_key.length() != client_key_size )
-            return std::unexpected( error( error_code_t::invalid_client_key_t ) );
+        // Make the authentication request to the server.
+        return finish_authentication( api_call< user >( *pool, pub_key, request_url( std::format( "authenticate?app_id={}", app_id ), query ), hwid ), open );
+    }
 
-        // Attempt to decode the client key from base64.
-        const auto decoded = base64::safe_from_base64( client_key );
+    void client::authenticate_async( std::function< void( result_t< user >&& ) > callback, bool open ) const noexcept
+    {
+        try
+        {
+            // The completion owns a copy of the client, so the request stays valid even if this client goes away first.
+            auto completion = [ self = *this, callback, open ]( result_t< std::string_view >&& payload )
+            {
+                if ( !payload )
+                    return callback( self.finish_authentication( std::unexpected( payload.error() ), open ) );
 
-        if ( !decoded )
-            return std::unexpected( error( error_code_t::failed_to_decode_public_key_t ) );
+                callback( self.finish_authentication( decode_payload< user >( *payload ), open ) );
+            };
 
-        // Make the initialization request to the server.
-        const auto result = api_call( *decoded, std::format( "initialize?app_id={}", app_id ) );
+            api_call_async( pool, pub_key, request_url( std::format( "authenticate?app_id={}", app_id ), query ), hwid, std::move( completion ) );
+        }
+        catch ( const std::exception& )
+        {
+            callback( std::unexpected( error( error_code_t::unexpected_error_t ) ) );
+        }
+    }
 
-        if ( !result )
-            return std::unexpected( result.error() );
+    std::future< result_t< user > > client::authenticate_async( bool open ) const
+    {
+        auto promise = std::make_shared< std::promise< result_t< user > > >();
+        auto future = promise->get_future();
 
-        // Set the dashboard hostname and exit. We don't deserialize the JSON because we only need the hostname.
-        const auto hostname = ( *result )[ "data" ][ "dashboard_hostname" ].template get< std::string >();
+        authenticate_async( [ promise ]( result_t< user >&& result ) { promise->set_value( std::move( result ) ); }, open );
 
-        return client( app_id, *decoded, hostname );
+        return future;
     }
 
-    result_t< user > client::authenticate( bool open ) const noexcept
+    result_t< user > client::finish_authentication( result_t< user >&& result, bool open ) const noexcept
     {
-        // Make the authentication request to the server.
-        const auto result = api_call< user >( pub_key, std::format( "authenticate?app_id={}", app_id ) );
-
         if ( !result )
         {
             if ( result.error() == error_code_t::unauthorized_t && open )
             {
-                // Try and get the HWID associated with the user's system.
-                const auto hwid = system::hwid();
-
-                if ( !hwid )
-                    return std::unexpected( error( error_code_t::failed_to_get_hwid_t ) );
-
                 // Open the user's default browser to prompt a login.
-                if ( !system::open_browser( std::format( "https://{}/auth/{}", hostname, *hwid ) ) )
+                if ( !system::open_browser( std::format( "https://{}/auth/{}", hostname, hwid ) ) )
                     return std::unexpected( error( error_code_t::failed_to_open_browser_t ) );
             } 
             
@@ -256,13 +576,61 @@ namespace tsar
             return std::unexpected( result.error() );
         }
 
-        return *result;
+        // The user keeps sending its heartbeats through the connections of this client, to a URL that is only built once.
+        try
+        {
+            result->hwid = hwid;
+            result->query = std::format( "?session={}{}", result->session, query );
+            result->heartbeat_url = request_url( "heartbeat", result->query );
+        }
+        catch ( const std::exception& )
+        {
+            return std::unexpected( error( error_code_t::unexpected_error_t ) );
+        }
+
+        result->pool = pool;
+
+        return std::move( *result );
+    }
+
+    http::pool::stats_t client::connection_stats() const noexcept
+    {
+        return pool->stats();
+    }
+
+    void client::set_max_response_size( std::size_t bytes ) const noexcept
+    {
+        pool->set_max_response_size( bytes );
+    }
+
+    void client::set_rate_limit( http::governor::endpoint_t endpoint, http::governor::limit_t limit ) const noexcept
+    {
+        pool->governor().set_limit( endpoint, limit );
+    }
+
+    void client::set_max_throttle_wait( std::chrono::milliseconds max_wait ) const noexcept
+    {
+        pool->governor().set_max_wait( max_wait );
+    }
+
+    http::governor::stats_t client::throttle_stats() const noexcept
+    {
+        return pool->governor().stats();
     }
 
-    client::client( const std::string_view app_id, const std::string_view pub_key, const std::string_view hostname )
+    client::client(
+        const std::string_view app_id,
+        crypto::key pub_key,
+        const std::string_view hostname,
+        const std::string_view hwid,
+        const std::string_view query,
+        std::shared_ptr< http::pool > pool )
         : app_id( app_id ),
-          pub_key( pub_key ),
-          hostname( hostname )
+          hostname( hostname ),
+          pub_key( std::move( pub_key ) ),
+          hwid( hwid ),
+          query( query ),
+          pool( std::move( pool ) )
     {
     }
 }  // namespace tsar
@@ -1,66 +1,65 @@
 #include "user.hpp"
 
-#include "base64.hpp"
+#include "http/arena.hpp"
 
 namespace tsar
 {
-    static void from_json( const nlohmann::json& json, subscription_t& subscription )
+    user::user( const nlohmann::json& json )
     {
-        json.at( "id" ).get_to( subscription.id );
-
-        if ( json[ "expires" ].is_null() )
-            subscription.expires = std::nullopt;
-        else
-            subscription.expires = std::chrono::system_clock::from_time_t( json.at( "expires" ).get< std::time_t >() );
+        try
+        {
+            // The JSON goes through the same decoder as the responses of the API, so both accept exactly the same users.
+            if ( decode::decode_dom( json, *this ) )
+                return;
+        }
+        catch ( const std::exception& )
+        {
+        }
 
-        json.at( "tier" ).get_to( subscription.tier );
+        throw error( error_code_t::failed_to_parse_body_t );
     }
 
-    result_t< nlohmann::json > user::api_query( const std::string_view endpoint ) const noexcept
+    result_t< void > user::heartbeat() const noexcept
     {
-        return client::api_call( session_key, std::format( "{}?session={}", endpoint, session ) );
+        if ( !pool )
+            return std::unexpected( error( error_code_t::unexpected_error_t ) );
+
+        // The heartbeat only needs the payload verified, so nothing is parsed into a DOM, and its buffers live in the arena of this thread.
+        std::pmr::string payload( http::arena::local().reset() );
+
+        return client::api_request( *pool, session_key, heartbeat_url, hwid, payload );
     }
 
-    user::user( const nlohmann::json& json )
+    void user::heartbeat_async( std::function< void( result_t< void >&& ) > callback ) const noexcept
     {
+        if ( !pool )
+            return callback( std::unexpected( error( error_code_t::unexpected_error_t ) ) );
+
         try
         {
-            json.at( "id" ).get_to( id );
-
-            if ( json[ "name" ].is_null() )
-                name = std::nullopt;
-            else
-                name = json.at( "name" ).get< std::string >();
-
-            if ( json[ "avatar" ].is_null() )
-                avatar = std::nullopt;
-            else
-                avatar = json.at( "avatar" ).get< std::string >();
+            auto completion = [ callback ]( result_t< std::string_view >&& result )
+            {
+                if ( !result )
+                    return callback( std::unexpected( result.error() ) );
 
-            json.at( "subscription" ).get_to( subscription );
+                callback( {} );
+            };
 
-            json.at( "session" ).get_to( session );
-
-            const auto key = base64::safe_from_base64( json.at( "session_key" ).get< std::string >() );
-
-            if ( !key )
-                throw error( error_code_t::failed_to_decode_session_key_t );
-
-            session_key = *key;
+            client::api_call_async( pool, session_key, heartbeat_url, hwid, std::move( completion ) );
         }
         catch ( const std::exception& )
         {
-            throw error( error_code_t::failed_to_parse_body_t );
+            callback( std::unexpected( error( error_code_t::unexpected_error_t ) ) );
         }
     }
 
-    result_t< void > user::heartbeat() const noexcept
+    std::future< result_t< void > > user::heartbeat_async() const
     {
-        const auto result = api_query( "heartbeat" );
+        auto promise = std::make_shared< std::promise< result_t< void > > >();
+        auto future = promise->get_future();
 
-        if ( !result )
-            return std::unexpected( result.error() );
+        heartbeat_async( [ promise ]( result_t< void >&& result ) { promise->set_value( std::move( result ) ); } );
 
-        return {};
+        return future;
     }
 }  // namespace tsar
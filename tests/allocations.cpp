@@ -0,0 +1,273 @@
+/*
+ * allocations.cpp
+ *
+ * Checks that the steady-state request path makes no heap allocations. A local stand-in server is started, a user is authenticated
+ * against it, and once the connection, the arena and the caches are warm, every `operator new` made by any thread during a series of
+ * heartbeats is counted. The test fails if there is a single one.
+ *
+ * Usage: allocations <path to the stand-in> [http port] [ntp port]
+ */
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <string_view>
+
+#include "tsar.hpp"
+#include "user.hpp"
+
+extern char** environ;
+
+namespace
+{
+    std::atomic< bool > counting = false;
+    std::atomic< std::size_t > allocations = 0;
+
+    void* allocate( std::size_t size ) noexcept
+    {
+        if ( counting.load( std::memory_order_relaxed ) )
+            allocations.fetch_add( 1, std::memory_order_relaxed );
+
+        return std::malloc( size ? size : 1 );
+    }
+
+    void* allocate( std::size_t size, std::align_val_t alignment ) noexcept
+    {
+        if ( counting.load( std::memory_order_relaxed ) )
+            allocations.fetch_add( 1, std::memory_order_relaxed );
+
+        const auto align = static_cast< std::size_t >( alignment );
+        return std::aligned_alloc( align, ( ( size ? size : 1 ) + align - 1 ) / align * align );
+    }
+
+    /// <summary>
+    /// The stand-in server, running as a child process for the lifetime of the test.
+    /// </summary>
+    class standin final
+    {
+       public:
+        standin( const char* path, const std::string& http_port, const std::string& ntp_port ) : pid( -1 ), output( nullptr )
+        {
+            int fds[ 2 ];
+
+            if ( pipe( fds ) != 0 )
+                return;
+
+            posix_spawn_file_actions_t actions;
+            posix_spawn_file_actions_init( &actions );
+            posix_spawn_file_actions_adddup2( &actions, fds[ 1 ], STDOUT_FILENO );
+            posix_spawn_file_actions_addclose( &actions, fds[ 0 ] );
+
+            const char* args[] = { path, "--port", http_port.c_str(), "--ntp-port", ntp_port.c_str(), "--quiet", nullptr };
+
+            if ( posix_spawn( &pid, path, &actions, nullptr, const_cast< char** >( args ), environ ) != 0 )
+                pid = -1;
+
+            posix_spawn_file_actions_destroy( &actions );
+            close( fds[ 1 ] );
+
+            output = fdopen( fds[ 0 ], "r" );
+        }
+
+        ~standin()
+        {
+            if ( pid > 0 )
+            {
+                kill( pid, SIGTERM );
+                waitpid( pid, nullptr, 0 );
+            }
+
+            if ( output )
+                fclose( output );
+        }
+
+        /// <summary>
+        /// Reads the credentials the stand-in prints once it is listening.
+        /// </summary>
+        bool read_credentials( std::string& app_id, std::string& client_key )
+        {
+            if ( pid <= 0 || !output )
+                return false;
+
+            char line[ 512 ];
+
+            while ( std::fgets( line, sizeof( line ), output ) )
+            {
+                std::string_view view( line );
+
+                while ( !view.empty() && ( view.back() == '\n' || view.back() == ' ' ) )
+                    view.remove_suffix( 1 );
+
+                const auto value = [ &view ] { return std::string( view.substr( view.find_first_not_of( ' ', view.find( ':' ) + 1 ) ) ); };
+
+                if ( view.starts_with( "App ID:" ) )
+                    app_id = value();
+                else if ( view.starts_with( "Client key:" ) )
+                    client_key = value();
+                else if ( view.starts_with( "NTP server:" ) )
+                    return !app_id.empty() && !client_key.empty();
+            }
+
+            return false;
+        }
+
+       private:
+        pid_t pid;
+        FILE* output;
+    };
+}  // namespace
+
+void* operator new( std::size_t size )
+{
+    if ( const auto memory = allocate( size ) )
+        return memory;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[]( std::size_t size )
+{
+    return operator new( size );
+}
+
+void* operator new( std::size_t size, std::align_val_t alignment )
+{
+    if ( const auto memory = allocate( size, alignment ) )
+        return memory;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[]( std::size_t size, std::align_val_t alignment )
+{
+    return operator new( size, alignment );
+}
+
+void* operator new( std::size_t size, const std::nothrow_t& ) noexcept
+{
+    return allocate( size );
+}
+
+void* operator new[]( std::size_t size, const std::nothrow_t& ) noexcept
+{
+    return allocate( size );
+}
+
+void operator delete( void* memory ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete[]( void* memory ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, std::size_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete[]( void* memory, std::size_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, std::align_val_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete[]( void* memory, std::align_val_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, std::size_t, std::align_val_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete[]( void* memory, std::size_t, std::align_val_t ) noexcept
+{
+    std::free( memory );
+}
+
+int main( int argc, char** argv )
+{
+    if ( argc < 2 )
+    {
+        std::cerr << "Usage: " << argv[ 0 ] << " <path to the stand-in> [http port] [ntp port]\n";
+        return 2;
+    }
+
+    const std::string http_port = argc > 2 ? argv[ 2 ] : "18090";
+    const std::string ntp_port = argc > 3 ? argv[ 3 ] : "11290";
+
+    standin server( argv[ 1 ], http_port, ntp_port );
+
+    std::string app_id, client_key;
+
+    if ( !server.read_credentials( app_id, client_key ) )
+    {
+        std::cerr << "Failed to start the stand-in.\n";
+        return 2;
+    }
+
+    tsar::client::set_api_url( "http://127.0.0.1:" + http_port + "/api/client" );
+    tsar::client::set_ntp_server( "127.0.0.1", static_cast< std::uint16_t >( std::stoi( ntp_port ) ) );
+
+    const auto client = tsar::client::create( app_id, client_key );
+
+    if ( !client )
+    {
+        std::cerr << "Failed to create the client: " << client.error().what() << '\n';
+        return 2;
+    }
+
+    const auto user = client->authenticate( false );
+
+    if ( !user )
+    {
+        std::cerr << "Failed to authenticate: " << user.error().what() << '\n';
+        return 2;
+    }
+
+    // The first requests open the connection, size the arena and fill the caches of the resolver and the NTP client.
+    for ( int i = 0; i < 20; i++ )
+    {
+        if ( const auto result = user->heartbeat(); !result )
+        {
+            std::cerr << "Warm-up heartbeat failed: " << result.error().what() << '\n';
+            return 2;
+        }
+    }
+
+    constexpr int heartbeats = 200;
+
+    counting = true;
+
+    for ( int i = 0; i < heartbeats; i++ )
+    {
+        if ( const auto result = user->heartbeat(); !result )
+        {
+            counting = false;
+            std::cerr << "Heartbeat failed: " << result.error().what() << '\n';
+            return 2;
+        }
+    }
+
+    counting = false;
+
+    std::cout << "Allocations in " << heartbeats << " heartbeats: " << allocations.load() << '\n';
+
+    return allocations.load() == 0 ? 0 : 1;
+}
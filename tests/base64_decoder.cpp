@@ -0,0 +1,483 @@
+/*
+ * base64_decoder.cpp
+ *
+ * Checks the decoding functions that report where base64 text is invalid against a plain model of the format, on 200000 random texts:
+ * valid ones, corrupted ones, a padded group followed by more text, partial trailing groups and groups of padding signs alone.
+ *
+ * `try_decode_to`, `try_decode_into` and both overloads of `try_decode_in_place`, whose output aliases the text, must give the bytes of
+ * the model or its error and offset. `decoder` must give the same bytes however the text is split into chunks, and report the first
+ * error of the text as it streams in.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base64.hpp"
+
+namespace
+{
+    /// <summary>
+    /// The outcome of decoding: the decoded data, or the code and offset of the error.
+    /// </summary>
+    struct outcome_t
+    {
+        bool ok = true;
+        std::string data;
+        base64::error_code_t code{};
+        std::size_t offset = 0;
+
+        bool operator==( const outcome_t& ) const = default;
+    };
+
+    outcome_t error( const base64::error_code_t code, const std::size_t offset = 0 )
+    {
+        return { false, {}, code, offset };
+    }
+
+    template< typename Result >
+    outcome_t outcome( const Result& result, const void* data )
+    {
+        if ( !result )
+            return error( result.error().code, result.error().offset );
+
+        return { true, std::string( static_cast< const char* >( data ), *result ) };
+    }
+
+    int value( const char c )
+    {
+        if ( c >= 'A' && c <= 'Z' )
+            return c - 'A';
+
+        if ( c >= 'a' && c <= 'z' )
+            return c - 'a' + 26;
+
+        if ( c >= '0' && c <= '9' )
+            return c - '0' + 52;
+
+        if ( c == '+' )
+            return 62;
+
+        if ( c == '/' )
+            return 63;
+
+        return -1;
+    }
+
+    /// <summary>
+    /// Decodes a group of 4 characters, of which only the first `count` are data and were validated.
+    /// </summary>
+    void append_group( std::string& data, const std::string_view group, const std::size_t count )
+    {
+        std::uint32_t bits = 0;
+
+        for ( std::size_t i = 0; i < 4; ++i )
+            bits = bits << 6 | static_cast< std::uint32_t >( i < count ? value( group[ i ] ) : 0 );
+
+        data += static_cast< char >( bits >> 16 );
+
+        if ( count > 2 )
+            data += static_cast< char >( bits >> 8 );
+
+        if ( count > 3 )
+            data += static_cast< char >( bits );
+    }
+
+    /// <summary>
+    /// Decodes a whole buffer. The size of the text and its padding are validated first, then every group in order.
+    /// </summary>
+    outcome_t decode_whole( const std::string_view text )
+    {
+        if ( text.size() % 4 != 0 )
+            return error( base64::error_code_t::invalid_length_t );
+
+        const auto padding = text.empty() ? 0 : static_cast< std::size_t >( std::count( text.end() - 4, text.end(), '=' ) );
+
+        if ( padding > 2 )
+            return error( base64::error_code_t::invalid_padding_t );
+
+        outcome_t result;
+
+        for ( std::size_t start = 0; start < text.size(); start += 4 )
+        {
+            const auto group = text.substr( start, 4 );
+            const auto count = start + 4 == text.size() ? 4 - padding : 4;
+
+            for ( std::size_t i = 0; i < count; ++i )
+            {
+                if ( value( group[ i ] ) < 0 )
+                    return error( base64::error_code_t::invalid_character_t, start + i );
+            }
+
+            append_group( result.data, group, count );
+        }
+
+        return result;
+    }
+
+    /// <summary>
+    /// Decodes text as it streams in, group by group. A group may end in padding signs, but nothing may follow it, and a partial group is
+    /// only an error once the text has ended. An error keeps the bytes of the groups in front of it.
+    /// </summary>
+    /// <param name="group_index">The index of the group that holds the error.</param>
+    outcome_t decode_stream( const std::string_view text, std::size_t& group_index )
+    {
+        outcome_t result;
+        std::size_t padding_offset = 0;
+        bool padded = false;
+
+        const auto stop = [ & ]( const base64::error_code_t code, const std::size_t offset = 0 )
+        {
+            result.ok = false;
+            result.code = code;
+            result.offset = offset;
+            return result;
+        };
+
+        for ( std::size_t start = 0; start < text.size(); start += 4 )
+        {
+            group_index = start / 4;
+
+            if ( padded )
+                return stop( base64::error_code_t::invalid_character_t, padding_offset );
+
+            if ( start + 4 > text.size() )
+                return stop( base64::error_code_t::invalid_length_t );
+
+            const auto group = text.substr( start, 4 );
+            const auto signs = static_cast< std::size_t >( std::count( group.begin(), group.end(), '=' ) );
+            const auto count = signs <= 2 ? 4 - signs : 4;
+
+            for ( std::size_t i = 0; i < count; ++i )
+            {
+                if ( value( group[ i ] ) < 0 )
+                    return stop( base64::error_code_t::invalid_character_t, start + i );
+            }
+
+            // The characters that are left can only be the padding signs.
+            if ( count < 4 )
+            {
+                padded = true;
+                padding_offset = start + count;
+            }
+
+            append_group( result.data, group, count );
+        }
+
+        return result;
+    }
+
+    std::size_t failures = 0, cases = 0;
+
+    void fail( const std::string_view what, const std::string_view text, const outcome_t& expected, const outcome_t& actual )
+    {
+        if ( ++failures > 20 )
+            return;
+
+        std::cerr << what << " differs for \"" << ( text.size() <= 64 ? text : text.substr( 0, 64 ) ) << "\" (" << text.size()
+                  << " characters): expected ";
+
+        const auto print = [ & ]( const outcome_t& outcome )
+        {
+            if ( outcome.ok )
+                std::cerr << outcome.data.size() << " bytes";
+            else
+                std::cerr << "error " << static_cast< int >( outcome.code ) << " at " << outcome.offset;
+        };
+
+        print( expected );
+        std::cerr << ", got ";
+        print( actual );
+        std::cerr << '\n';
+    }
+
+    void check( const std::string_view what, const std::string_view text, const outcome_t& expected, const outcome_t& actual )
+    {
+        if ( actual != expected )
+            fail( what, text, expected, actual );
+    }
+
+    /// <summary>
+    /// Checks every function that decodes a whole buffer. The output buffers have the exact size the function needs, so that a write past
+    /// the end is caught by the sanitizers.
+    /// </summary>
+    void check_buffers( const std::string_view text )
+    {
+        const auto expected = decode_whole( text );
+
+        std::string decoded;
+        const auto to = base64::try_decode_to( text, decoded );
+        check( "try_decode_to", text, expected, outcome( to, decoded.data() ) );
+
+        std::vector< std::byte > bytes;
+        const auto to_bytes = base64::try_decode_to( text, bytes );
+        check( "try_decode_to into bytes", text, expected, outcome( to_bytes, bytes.data() ) );
+
+        // A buffer that is one byte short must be reported as too small, but only after the text itself was validated.
+        const auto size = base64::detail::decoded_size( text ).value_or( 0 );
+        const auto too_small = size > 0 && ( expected.ok || expected.code == base64::error_code_t::invalid_character_t );
+
+        std::vector< char > into( size );
+        const auto into_result = base64::try_decode_into( text, std::span< char >( into ) );
+        check( "try_decode_into", text, expected, outcome( into_result, into.data() ) );
+
+        std::vector< std::byte > short_buffer( size > 0 ? size - 1 : 0 );
+        const auto short_result = base64::try_decode_into( text, std::span< std::byte >( short_buffer ) );
+        check( "try_decode_into a short buffer", text, too_small ? error( base64::error_code_t::output_too_small_t ) : expected,
+               outcome( short_result, short_buffer.data() ) );
+
+        // In place, every group is written over the text it was decoded from.
+        std::vector< char > span_buffer( text.begin(), text.end() );
+        const auto span_result = base64::try_decode_in_place( std::span< char >( span_buffer ) );
+        check( "try_decode_in_place", text, expected, outcome( span_result, span_buffer.data() ) );
+
+        std::string string_buffer( text );
+        const auto string_result = base64::try_decode_in_place( string_buffer );
+        check( "try_decode_in_place on a string", text, expected, outcome( string_result, string_buffer.data() ) );
+
+        if ( string_buffer.size() != ( string_result ? *string_result : text.size() ) )
+            fail( "the size of the string decoded in place", text, expected, outcome( string_result, string_buffer.data() ) );
+
+        std::vector< unsigned char > vector_buffer( text.begin(), text.end() );
+        const auto vector_result = base64::try_decode_in_place( vector_buffer );
+        check( "try_decode_in_place on a vector", text, expected, outcome( vector_result, vector_buffer.data() ) );
+
+        if ( vector_buffer.size() != ( vector_result ? *vector_result : text.size() ) )
+            fail( "the size of the vector decoded in place", text, expected, outcome( vector_result, vector_buffer.data() ) );
+    }
+
+    /// <summary>
+    /// Feeds the text to the decoder in the given chunks, and checks the bytes it passed to the sink and its first error.
+    /// </summary>
+    void check_decoder( base64::decoder& decoder, const std::string_view text, const std::vector< std::size_t >& splits, const std::string_view what )
+    {
+        std::size_t group_index = 0;
+        const auto expected = decode_stream( text, group_index );
+
+        decoder.reset();
+
+        std::string data;
+        bool oversized = false;
+        const auto sink = [ & ]( const std::string_view bytes )
+        {
+            oversized |= bytes.size() > base64::decoder::window_size;
+            data.append( bytes );
+        };
+
+        std::expected< void, base64::base64_error > first;
+        std::size_t begin = 0;
+
+        for ( const auto split : splits )
+        {
+            const auto result = decoder.feed( text.substr( begin, split - begin ), sink );
+            begin = split;
+
+            // Once an error is returned, every later call returns it as well.
+            if ( !first )
+            {
+                if ( result || result.error().code != first.error().code || result.error().offset != first.error().offset )
+                    fail( std::string( what ) + ": a feed after the error", text, expected, outcome_t{} );
+            }
+            else if ( !result )
+                first = result;
+        }
+
+        const auto finished = decoder.finish();
+
+        if ( !first && ( finished || finished.error().code != first.error().code || finished.error().offset != first.error().offset ) )
+            fail( std::string( what ) + ": finish after the error", text, expected, outcome_t{} );
+
+        if ( oversized )
+            fail( std::string( what ) + ": the pieces passed to the sink", text, expected, outcome_t{} );
+
+        const outcome_t actual = finished ? outcome_t{ true, data } : error( finished.error().code, finished.error().offset );
+
+        if ( actual.ok || expected.ok )
+        {
+            check( what, text, expected, actual );
+            return;
+        }
+
+        // The bytes passed before an error are a prefix of the decoded text.
+        if ( expected.data.compare( 0, data.size(), data ) != 0 )
+            fail( std::string( what ) + ": the bytes before the error", text, expected, actual );
+
+        // A group of more than 2 padding signs is reported as invalid padding rather than an invalid character when it ends a window of
+        // the decoder, and then it hides the errors in front of it in that window.
+        const auto window_groups = base64::decoder::window_size / 3;
+
+        if ( actual.code == base64::error_code_t::invalid_padding_t )
+        {
+            for ( auto index = group_index; index < group_index + window_groups && index * 4 + 4 <= text.size(); ++index )
+            {
+                const auto group = text.substr( index * 4, 4 );
+
+                if ( std::count( group.begin(), group.end(), '=' ) > 2 )
+                    return;
+            }
+        }
+
+        check( what, text, error( expected.code, expected.offset ), actual );
+    }
+
+    constexpr std::size_t constant_offset()
+    {
+        std::array< char, 6 > decoded{};
+        const auto result = base64::try_decode_into( "QUJDRA*=", decoded );
+        return result ? 0 : result.error().offset;
+    }
+
+    // The offsets are the same in a constant expression, where the kernels are not used.
+    static_assert( constant_offset() == 6 );
+}  // namespace
+
+int main()
+{
+    std::mt19937_64 random( 0xDEC0DE );
+
+    const auto below = [ & ]( const std::size_t bound ) { return std::uniform_int_distribution< std::size_t >( 0, bound - 1 )( random ); };
+
+    constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    const auto random_bytes = [ & ]( const std::size_t size )
+    {
+        std::string bytes( size, '\0' );
+
+        for ( auto& c : bytes )
+            c = static_cast< char >( below( 256 ) );
+
+        return bytes;
+    };
+
+    // Mostly short texts, and some that span several windows of the decoder and the blocks of the kernels.
+    const auto random_size = [ & ] { return below( 16 ) == 0 ? below( 3000 ) : below( 64 ); };
+
+    const auto random_character = [ & ]
+    {
+        switch ( below( 3 ) )
+        {
+            case 0: return alphabet[ below( alphabet.size() ) ];
+            case 1: return '=';
+            default: return static_cast< char >( below( 256 ) );
+        }
+    };
+
+    base64::decoder decoder;
+
+    for ( std::size_t i = 0; i < 200000; ++i )
+    {
+        auto text = base64::to_base64( random_bytes( random_size() ) );
+
+        switch ( i % 6 )
+        {
+            case 0:
+                break;
+
+            case 1:
+            {
+                // Corrupted at a few random places.
+                for ( std::size_t j = 0, count = 1 + below( 3 ); j < count && !text.empty(); ++j )
+                    text[ below( text.size() ) ] = random_character();
+
+                break;
+            }
+
+            case 2:
+            {
+                // A padded group followed by more text, which may itself be valid or end in a partial group.
+                auto first = random_bytes( random_size() );
+
+                if ( first.size() % 3 == 0 )
+                    first += 'x';
+
+                text = base64::to_base64( first ) + text;
+
+                if ( below( 2 ) == 0 && !text.empty() )
+                    text.pop_back();
+
+                break;
+            }
+
+            case 3:
+            {
+                // A partial trailing group.
+                for ( std::size_t j = 0, count = 1 + below( 3 ); j < count; ++j )
+                    text += below( 4 ) == 0 ? '=' : alphabet[ below( alphabet.size() ) ];
+
+                break;
+            }
+
+            case 4:
+            {
+                // A valid text cut short.
+                text.resize( text.size() - std::min( text.size(), 1 + below( 3 ) ) );
+                break;
+            }
+
+            default:
+            {
+                // A group of padding signs, or of padding signs and data in the wrong order.
+                constexpr std::array< std::string_view, 6 > groups = { "====", "A===", "AB=C", "A=BC", "=ABC", "==AB" };
+
+                const auto group = groups[ below( groups.size() ) ];
+                const auto position = below( text.size() / 4 + 1 ) * 4;
+                text.insert( position, group );
+                break;
+            }
+        }
+
+        check_buffers( text );
+
+        // The decoder must accept valid text exactly like a whole buffer.
+        std::size_t group_index = 0;
+
+        if ( const auto whole = decode_whole( text ); whole.ok && decode_stream( text, group_index ) != whole )
+            fail( "the model of the decoder", text, whole, decode_stream( text, group_index ) );
+
+        // The text in one chunk, in tiny chunks that split most groups, and in chunks of any size, empty ones included.
+        std::vector< std::size_t > splits;
+
+        splits.push_back( text.size() );
+        check_decoder( decoder, text, splits, "decoder in one chunk" );
+
+        splits.clear();
+
+        for ( std::size_t split = 0; split < text.size(); )
+        {
+            split = std::min( text.size(), split + below( 6 ) );
+            splits.push_back( split );
+        }
+
+        splits.push_back( text.size() );
+        check_decoder( decoder, text, splits, "decoder in tiny chunks" );
+
+        splits.clear();
+
+        for ( std::size_t split = 0; split < text.size(); )
+        {
+            split = std::min( text.size(), split + ( below( 4 ) == 0 ? 0 : below( 2048 ) ) );
+            splits.push_back( split );
+        }
+
+        splits.push_back( text.size() );
+        check_decoder( decoder, text, splits, "decoder in random chunks" );
+
+        ++cases;
+    }
+
+    if ( failures )
+    {
+        std::cerr << failures << " mismatches in " << cases << " texts\n";
+        return 1;
+    }
+
+    std::cout << "All " << cases << " texts match the model.\n";
+    return 0;
+}
@@ -0,0 +1,265 @@
+/*
+ * base64_kernels.cpp
+ *
+ * Checks that every vectorized base64 kernel the CPU supports produces exactly the output of the scalar tables, the build with
+ * BASE64_NO_SIMD. Each kernel is run the way the library runs it, on the bulk of the text, with the scalar build finishing the rest, on
+ * random data and on corrupted text. Decoding must stop in front of the first invalid character, so that the error and its offset are
+ * the same as without the kernels, and must also work when the output aliases the text.
+ */
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base64.hpp"
+#include "base64_reference.hpp"
+
+namespace simd = base64::detail::simd;
+
+namespace
+{
+    struct kernel_t
+    {
+        std::string_view name;
+        simd::encode_t encode;
+        simd::decode_t decode;
+
+        /// <summary>
+        /// How much of the input the kernel consumed over the whole test, to make sure it was actually exercised.
+        /// </summary>
+        std::size_t encoded = 0, decoded = 0;
+
+        std::size_t failures = 0;
+    };
+
+    std::size_t failures = 0;
+
+    void fail( kernel_t& kernel, const std::string_view what, const std::string_view input )
+    {
+        ++kernel.failures;
+
+        if ( ++failures <= 20 )
+            std::cerr << kernel.name << ": " << what << " for an input of " << input.size() << " bytes\n";
+    }
+
+    /// <summary>
+    /// Encodes like `base64::to_base64`, with the given kernel on the bulk of the data.
+    /// </summary>
+    std::string encode_with( kernel_t& kernel, const std::string_view bytes )
+    {
+        std::string encoded( ( bytes.size() + 2 ) / 3 * 4, '=' );
+
+        const auto consumed = kernel.encode( reinterpret_cast< const std::uint8_t* >( bytes.data() ), bytes.size(), encoded.data() );
+        kernel.encoded += consumed;
+
+        if ( consumed % 3 != 0 || consumed > bytes.size() )
+        {
+            fail( kernel, "encoding consumed a partial group", bytes );
+            return {};
+        }
+
+        encoded.resize( consumed / 3 * 4 );
+        return encoded + reference::encode( bytes.substr( consumed ) );
+    }
+
+    /// <summary>
+    /// Decodes like `base64::try_decode_to`, or like `base64::try_decode_in_place` if `in_place` is set, with the given kernel on the
+    /// bulk of the text.
+    /// </summary>
+    reference::decoded_t decode_with( kernel_t& kernel, const std::string_view text, const bool in_place )
+    {
+        const auto size = base64::detail::decoded_size( text );
+
+        if ( !size )
+            return { false, {}, static_cast< int >( size.error().code ), size.error().offset };
+
+        const auto padding = text.size() / 4 * 3 - *size;
+        const auto groups = text.size() / 4 - ( padding != 0 );
+
+        // The buffers have the exact size the library gives them, so that a kernel writing past the end is caught by the sanitizers.
+        std::vector< char > input( text.begin(), text.end() );
+        std::vector< char > separate( *size );
+        const auto output = in_place ? input.data() : separate.data();
+
+        const auto consumed = kernel.decode( reinterpret_cast< const std::uint8_t* >( input.data() ), groups * 4, output );
+        kernel.decoded += consumed;
+
+        if ( consumed % 4 != 0 || consumed > groups * 4 )
+        {
+            fail( kernel, "decoding consumed a partial group", text );
+            return {};
+        }
+
+        // Whatever the kernel left behind is decoded by the scalar build, which reports the errors.
+        const auto rest = reference::decode( std::string_view( input.data() + consumed, input.size() - consumed ) );
+
+        if ( !rest.ok )
+            return { false, {}, rest.code, rest.offset + consumed };
+
+        std::string decoded( output, consumed / 4 * 3 );
+        return { true, decoded + rest.data };
+    }
+
+    void check( kernel_t& kernel, const std::string_view bytes )
+    {
+        if ( encode_with( kernel, bytes ) != reference::encode( bytes ) )
+            fail( kernel, "encoding differs", bytes );
+    }
+
+    void check_text( kernel_t& kernel, const std::string_view text )
+    {
+        const auto expected = reference::decode( text );
+
+        if ( decode_with( kernel, text, false ) != expected )
+            fail( kernel, "decoding differs", text );
+
+        if ( decode_with( kernel, text, true ) != reference::decode_in_place( std::string( text ) ) )
+            fail( kernel, "decoding in place differs", text );
+    }
+
+    /// <summary>
+    /// Checks the functions of the library, with the kernels it selected for this CPU, against the scalar build.
+    /// </summary>
+    void check_library( const std::string_view bytes, const std::string_view text )
+    {
+        if ( base64::to_base64( bytes ) != reference::encode( bytes ) )
+        {
+            std::cerr << "to_base64 differs for an input of " << bytes.size() << " bytes\n";
+            ++failures;
+        }
+
+        std::string decoded;
+        const auto result = base64::try_decode_to( text, decoded );
+        const auto expected = reference::decode( text );
+
+        const reference::decoded_t actual = result ? reference::decoded_t{ true, decoded.substr( 0, *result ) }
+                                                   : reference::decoded_t{ false, {}, static_cast< int >( result.error().code ),
+                                                                           result.error().offset };
+
+        if ( actual != expected )
+        {
+            std::cerr << "try_decode_to differs for an input of " << text.size() << " bytes\n";
+            ++failures;
+        }
+    }
+
+    std::vector< kernel_t > supported_kernels()
+    {
+        std::vector< kernel_t > kernels;
+
+#if defined( BASE64_SIMD_X86 )
+        __builtin_cpu_init();
+
+        if ( __builtin_cpu_supports( "sse4.1" ) )
+            kernels.push_back( { "sse4.1", simd::encode_sse41, simd::decode_sse41 } );
+
+        if ( __builtin_cpu_supports( "avx2" ) )
+            kernels.push_back( { "avx2", simd::encode_avx2, simd::decode_avx2 } );
+#elif defined( BASE64_SIMD_NEON )
+        kernels.push_back( { "neon", simd::encode_neon, simd::decode_neon } );
+#endif
+
+        return kernels;
+    }
+}  // namespace
+
+int main()
+{
+    auto kernels = supported_kernels();
+
+    if ( kernels.empty() )
+        std::cout << "No vectorized kernels on this CPU, only the library itself is checked.\n";
+
+    std::mt19937_64 random( 0xB64 );
+    std::uniform_int_distribution< int > byte( 0, 255 );
+
+    const auto random_bytes = [ & ]( std::size_t size )
+    {
+        std::string bytes( size, '\0' );
+
+        for ( auto& c : bytes )
+            c = static_cast< char >( byte( random ) );
+
+        return bytes;
+    };
+
+    // Every size around the block sizes of the kernels, and a few large ones.
+    std::vector< std::size_t > sizes;
+
+    for ( std::size_t size = 0; size <= 400; ++size )
+        sizes.push_back( size );
+
+    for ( const auto size : { 4096, 65535, 65536, 1 << 20 } )
+        sizes.push_back( static_cast< std::size_t >( size ) );
+
+    for ( const auto size : sizes )
+    {
+        const auto bytes = random_bytes( size );
+        const auto text = reference::encode( bytes );
+
+        check_library( bytes, text );
+
+        for ( auto& kernel : kernels )
+        {
+            check( kernel, bytes );
+            check_text( kernel, text );
+        }
+
+        if ( size > 4096 )
+            continue;
+
+        // The same text corrupted at a few random places, with any byte, padding included.
+        for ( int i = 0; i < 8 && !text.empty(); ++i )
+        {
+            auto corrupted = text;
+
+            for ( int j = 0, count = 1 + i % 3; j < count; ++j )
+            {
+                const auto position = std::uniform_int_distribution< std::size_t >( 0, corrupted.size() - 1 )( random );
+                corrupted[ position ] = i % 4 == 3 ? '=' : static_cast< char >( byte( random ) );
+            }
+
+            check_library( bytes, corrupted );
+
+            for ( auto& kernel : kernels )
+                check_text( kernel, corrupted );
+        }
+    }
+
+    // Every byte value at every position of the blocks of the widest kernel.
+    const auto text = reference::encode( random_bytes( 96 ) );
+
+    for ( std::size_t position = 0; position < 96; ++position )
+    {
+        for ( int value = 0; value < 256; ++value )
+        {
+            auto corrupted = text;
+            corrupted[ position ] = static_cast< char >( value );
+
+            for ( auto& kernel : kernels )
+                check_text( kernel, corrupted );
+        }
+    }
+
+    for ( const auto& kernel : kernels )
+    {
+        if ( kernel.encoded == 0 || kernel.decoded == 0 )
+        {
+            std::cerr << kernel.name << ": the kernel never consumed any input\n";
+            ++failures;
+        }
+        else if ( kernel.failures == 0 )
+            std::cout << kernel.name << ": matches the scalar build\n";
+    }
+
+    if ( failures )
+    {
+        std::cerr << failures << " mismatches\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+// The scalar build of the library lives in a namespace of its own, so that it does not clash with the vectorized build of the other
+// translation units.
+#define BASE64_NO_SIMD
+#define base64 base64_scalar
+#include "base64.hpp"
+#undef base64
+
+#include "base64_reference.hpp"
+
+namespace reference
+{
+    template< typename Result >
+    static decoded_t outcome( const Result& result, std::string data )
+    {
+        if ( !result )
+            return { false, {}, static_cast< int >( result.error().code ), result.error().offset };
+
+        data.resize( *result );
+        return { true, std::move( data ) };
+    }
+
+    std::string encode( const std::string_view bytes )
+    {
+        return base64_scalar::to_base64( bytes );
+    }
+
+    decoded_t decode( const std::string_view text )
+    {
+        std::string data;
+        const auto result = base64_scalar::try_decode_to( text, data );
+        return outcome( result, std::move( data ) );
+    }
+
+    decoded_t decode_in_place( std::string text )
+    {
+        const auto result = base64_scalar::try_decode_in_place( std::span< char >( text ) );
+        return outcome( result, std::move( text ) );
+    }
+}  // namespace reference
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/// <summary>
+/// The base64 functions built with BASE64_NO_SIMD, so that the vectorized kernels can be compared with the scalar tables in the same
+/// process. They are compiled in a translation unit of their own, with the namespace of the library renamed.
+/// </summary>
+namespace reference
+{
+    /// <summary>
+    /// The outcome of decoding: the decoded data, or the code and offset of the error.
+    /// </summary>
+    struct decoded_t
+    {
+        bool ok = false;
+        std::string data;
+        int code = 0;
+        std::size_t offset = 0;
+
+        bool operator==( const decoded_t& ) const = default;
+    };
+
+    std::string encode( std::string_view bytes );
+
+    decoded_t decode( std::string_view text );
+
+    decoded_t decode_in_place( std::string text );
+}  // namespace reference
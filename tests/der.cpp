@@ -0,0 +1,161 @@
+/*
+ * der.cpp
+ *
+ * Checks `der::encode_signature` byte for byte against the encoding of OpenSSL, `i2d_ECDSA_SIG`, for the edge cases of the DER integer
+ * encoding and for random signatures. Raw signatures that are not 64 bytes long must not be encoded at all.
+ */
+
+#include <openssl/bn.h>
+#include <openssl/ecdsa.h>
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "crypto/der.hpp"
+
+namespace der = tsar::crypto::der;
+
+namespace
+{
+    std::size_t failures = 0;
+
+    std::string hex( const std::uint8_t* data, std::size_t size )
+    {
+        constexpr char digits[] = "0123456789abcdef";
+
+        std::string text;
+
+        for ( std::size_t i = 0; i < size; ++i )
+        {
+            text += digits[ data[ i ] >> 4 ];
+            text += digits[ data[ i ] & 0xF ];
+        }
+
+        return text;
+    }
+
+    /// <summary>
+    /// Encodes a raw signature with OpenSSL.
+    /// </summary>
+    std::string reference( const std::string_view raw )
+    {
+        const auto r = BN_bin2bn( reinterpret_cast< const unsigned char* >( raw.data() ), 32, nullptr );
+        const auto s = BN_bin2bn( reinterpret_cast< const unsigned char* >( raw.data() ) + 32, 32, nullptr );
+        const auto signature = ECDSA_SIG_new();
+
+        std::string encoded;
+
+        if ( r && s && signature && ECDSA_SIG_set0( signature, r, s ) == 1 )
+        {
+            unsigned char* out = nullptr;
+            const auto size = i2d_ECDSA_SIG( signature, &out );
+
+            if ( size > 0 )
+                encoded = hex( out, static_cast< std::size_t >( size ) );
+
+            OPENSSL_free( out );
+        }
+        else
+        {
+            BN_free( r );
+            BN_free( s );
+        }
+
+        ECDSA_SIG_free( signature );
+        return encoded;
+    }
+
+    void check( const std::string_view name, const std::string& raw )
+    {
+        std::array< std::uint8_t, der::max_signature_size > out{};
+        const auto size = der::encode_signature( raw, out );
+
+        const auto expected = reference( raw );
+        const auto actual = hex( out.data(), size );
+
+        if ( expected.empty() || actual != expected )
+        {
+            std::cerr << name << ": expected " << expected << ", got " << actual << '\n';
+            ++failures;
+        }
+    }
+
+    /// <summary>
+    /// Builds a raw signature from the two halves, each repeated to 32 bytes after the given number of leading zeros.
+    /// </summary>
+    std::string raw( std::size_t r_zeros, std::uint8_t r_byte, std::size_t s_zeros, std::uint8_t s_byte )
+    {
+        std::string signature( 64, '\0' );
+
+        for ( auto i = r_zeros; i < 32; ++i )
+            signature[ i ] = static_cast< char >( r_byte );
+
+        for ( auto i = s_zeros; i < 32; ++i )
+            signature[ 32 + i ] = static_cast< char >( s_byte );
+
+        return signature;
+    }
+}  // namespace
+
+int main()
+{
+    check( "all zeros", raw( 32, 0, 32, 0 ) );
+    check( "zero r", raw( 32, 0, 0, 0x12 ) );
+    check( "zero s", raw( 0, 0x12, 32, 0 ) );
+    check( "high bit r", raw( 0, 0x80, 0, 0x7F ) );
+    check( "high bit s", raw( 0, 0x7F, 0, 0xFF ) );
+    check( "high bit r and s", raw( 0, 0xFF, 0, 0x80 ) );
+
+    // Every number of leading zeros, with and without the high bit set on the first byte that is left.
+    for ( std::size_t zeros = 1; zeros < 32; ++zeros )
+    {
+        check( "leading zeros in r", raw( zeros, 0x01, 0, 0x42 ) );
+        check( "leading zeros in s", raw( 0, 0x42, zeros, 0x01 ) );
+        check( "leading zeros and high bit in r", raw( zeros, 0x80, 0, 0x42 ) );
+        check( "leading zeros and high bit in s", raw( 0, 0x42, zeros, 0xC0 ) );
+    }
+
+    std::mt19937_64 random( 0x5EED );
+    std::uniform_int_distribution< int > byte( 0, 255 );
+
+    for ( int i = 0; i < 100000; ++i )
+    {
+        std::string signature( 64, '\0' );
+
+        for ( auto& c : signature )
+            c = static_cast< char >( byte( random ) );
+
+        // Short integers are rare in random signatures, so some are forced.
+        if ( i % 4 == 1 )
+            signature[ 0 ] = '\0';
+        else if ( i % 4 == 2 )
+            signature[ 32 ] = signature[ 33 ] = '\0';
+
+        check( "random", signature );
+    }
+
+    // Raw signatures of any other length are rejected.
+    std::array< std::uint8_t, der::max_signature_size > out{};
+
+    for ( const auto size : { 0, 1, 32, 63, 65, 72, 128 } )
+    {
+        if ( der::encode_signature( std::string( static_cast< std::size_t >( size ), '\x01' ), out ) != 0 )
+        {
+            std::cerr << "a raw signature of " << size << " bytes was encoded\n";
+            ++failures;
+        }
+    }
+
+    if ( failures )
+    {
+        std::cerr << failures << " mismatches\n";
+        return 1;
+    }
+
+    std::cout << "All encodings match OpenSSL.\n";
+    return 0;
+}
@@ -0,0 +1,698 @@
+/*
+ * standin.cpp
+ *
+ * A local stand-in for the TSAR API and its NTP server, for load testing and benchmarking the SDK without the live service.
+ *
+ * The API is served over plain HTTP/1.1 with keep-alive, and every response is signed with a P-256 key generated at startup, in the same
+ * data/signature envelope as the live API. Latency, jitter, rate limiting and dropped connections can be injected to measure tail latency
+ * and retry behavior.
+ *
+ * Point the SDK at it with:
+ *   TSAR_API_URL=http://127.0.0.1:8080/api/client TSAR_NTP_SERVER=127.0.0.1:1230 ./app
+ * or with `tsar::client::set_api_url` and `tsar::client::set_ntp_server`, and use the app ID and client key printed at startup.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/x509.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace standin
+{
+    /// <summary>
+    /// The command line options of the stand-in.
+    /// </summary>
+    struct options_t
+    {
+        std::string bind = "127.0.0.1";
+        std::uint16_t http_port = 8080;
+        std::uint16_t ntp_port = 1230;
+
+        /// <summary>
+        /// The delay added to every response, plus a uniformly distributed jitter of up to `jitter`.
+        /// </summary>
+        std::chrono::milliseconds latency{ 0 }, jitter{ 0 };
+
+        /// <summary>
+        /// The probability of answering with 429 Too Many Requests, and the Retry-After it carries. Zero omits the header.
+        /// </summary>
+        double rate_limit = 0.0;
+        std::uint32_t retry_after = 1;
+
+        /// <summary>
+        /// The probability of closing the connection instead of answering.
+        /// </summary>
+        double drop = 0.0;
+
+        /// <summary>
+        /// The number of authentication requests answered with 401 before a login succeeds, as if the user was logging in.
+        /// </summary>
+        std::uint32_t auth_polls = 0;
+
+        bool quiet = false;
+    };
+
+    using pkey_ptr = std::unique_ptr< EVP_PKEY, decltype( &EVP_PKEY_free ) >;
+
+    /// <summary>
+    /// Counters printed when the stand-in exits.
+    /// </summary>
+    struct counters_t
+    {
+        std::atomic< std::uint64_t > requests{ 0 }, rate_limited{ 0 }, dropped{ 0 }, ntp{ 0 };
+    };
+
+    static std::atomic< bool > stopping{ false };
+    static counters_t counters;
+
+    static std::string base64( const std::string_view input )
+    {
+        std::string output( 4 * ( ( input.size() + 2 ) / 3 ), '\0' );
+        const auto size = EVP_EncodeBlock(
+            reinterpret_cast< unsigned char* >( output.data() ), reinterpret_cast< const unsigned char* >( input.data() ), static_cast< int >( input.size() ) );
+
+        output.resize( static_cast< std::size_t >( size ) );
+        return output;
+    }
+
+    static pkey_ptr generate_key()
+    {
+        EVP_PKEY* key = nullptr;
+        const auto ctx = EVP_PKEY_CTX_new_id( EVP_PKEY_EC, nullptr );
+
+        if ( ctx && EVP_PKEY_keygen_init( ctx ) == 1 && EVP_PKEY_CTX_set_ec_paramgen_curve_nid( ctx, NID_X9_62_prime256v1 ) == 1 )
+            EVP_PKEY_keygen( ctx, &key );
+
+        EVP_PKEY_CTX_free( ctx );
+        return pkey_ptr( key, EVP_PKEY_free );
+    }
+
+    /// <summary>
+    /// Gets the base64 DER encoding of the public half of a key, which is the format of client and session keys.
+    /// </summary>
+    static std::string public_key( EVP_PKEY* key )
+    {
+        const auto size = i2d_PUBKEY( key, nullptr );
+
+        if ( size <= 0 )
+            return {};
+
+        std::string der( static_cast< std::size_t >( size ), '\0' );
+        auto out = reinterpret_cast< unsigned char* >( der.data() );
+        i2d_PUBKEY( key, &out );
+
+        return base64( der );
+    }
+
+    /// <summary>
+    /// Signs a payload with ECDSA over SHA-256, returning the raw r || s signature the SDK expects.
+    /// </summary>
+    static std::optional< std::string > sign( EVP_PKEY* key, const std::string_view payload )
+    {
+        const auto ctx = EVP_MD_CTX_new();
+
+        if ( !ctx )
+            return std::nullopt;
+
+        std::size_t size = 0;
+        std::vector< unsigned char > der;
+
+        auto ok = EVP_DigestSignInit( ctx, nullptr, EVP_sha256(), nullptr, key ) == 1 &&
+                  EVP_DigestSign( ctx, nullptr, &size, reinterpret_cast< const unsigned char* >( payload.data() ), payload.size() ) == 1;
+
+        if ( ok )
+        {
+            der.resize( size );
+            ok = EVP_DigestSign( ctx, der.data(), &size, reinterpret_cast< const unsigned char* >( payload.data() ), payload.size() ) == 1;
+        }
+
+        EVP_MD_CTX_free( ctx );
+
+        if ( !ok )
+            return std::nullopt;
+
+        const unsigned char* in = der.data();
+        const auto signature = d2i_ECDSA_SIG( nullptr, &in, static_cast< long >( size ) );
+
+        if ( !signature )
+            return std::nullopt;
+
+        std::string raw( 64, '\0' );
+        BN_bn2binpad( ECDSA_SIG_get0_r( signature ), reinterpret_cast< unsigned char* >( raw.data() ), 32 );
+        BN_bn2binpad( ECDSA_SIG_get0_s( signature ), reinterpret_cast< unsigned char* >( raw.data() + 32 ), 32 );
+
+        ECDSA_SIG_free( signature );
+        return raw;
+    }
+
+    static std::string random_hex( std::size_t bytes )
+    {
+        constexpr char digits[] = "0123456789abcdef";
+
+        std::vector< unsigned char > buffer( bytes );
+        RAND_bytes( buffer.data(), static_cast< int >( bytes ) );
+
+        std::string output;
+        output.reserve( bytes * 2 );
+
+        for ( const auto byte : buffer )
+        {
+            output.push_back( digits[ byte >> 4 ] );
+            output.push_back( digits[ byte & 0xF ] );
+        }
+
+        return output;
+    }
+
+    static std::string random_uuid()
+    {
+        auto hex = random_hex( 16 );
+
+        for ( const auto position : { 8, 13, 18, 23 } )
+            hex.insert( hex.begin() + position, '-' );
+
+        return hex;
+    }
+
+    /// <summary>
+    /// Decodes the percent-encoding of a query parameter.
+    /// </summary>
+    static std::string url_decode( const std::string_view value )
+    {
+        std::string output;
+        output.reserve( value.size() );
+
+        for ( std::size_t i = 0; i < value.size(); ++i )
+        {
+            unsigned int byte = 0;
+
+            if ( value[ i ] == '%' && i + 2 < value.size() && std::from_chars( value.data() + i + 1, value.data() + i + 3, byte, 16 ).ec == std::errc{} )
+            {
+                output.push_back( static_cast< char >( byte ) );
+                i += 2;
+            }
+            else
+                output.push_back( value[ i ] == '+' ? ' ' : value[ i ] );
+        }
+
+        return output;
+    }
+
+    static std::string query_parameter( const std::string_view query, const std::string_view name )
+    {
+        std::size_t start = 0;
+
+        while ( start <= query.size() )
+        {
+            const auto end = std::min( query.find( '&', start ), query.size() );
+            const auto pair = query.substr( start, end - start );
+
+            if ( pair.size() > name.size() && pair.starts_with( name ) && pair[ name.size() ] == '=' )
+                return url_decode( pair.substr( name.size() + 1 ) );
+
+            start = end + 1;
+        }
+
+        return {};
+    }
+
+    /// <summary>
+    /// The API half of the stand-in.
+    /// </summary>
+    class api final
+    {
+        const options_t& options;
+
+        pkey_ptr app_key, session_key;
+        std::string app_id, session_public_key;
+
+        std::mutex mutex;
+        std::unordered_set< std::string > sessions;
+        std::unordered_map< std::string, std::uint32_t > polls;
+
+       public:
+        explicit api( const options_t& options )
+            : options( options ),
+              app_key( generate_key() ),
+              session_key( generate_key() ),
+              app_id( random_uuid() ),
+              session_public_key( public_key( session_key.get() ) )
+        {
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return app_key && session_key;
+        }
+
+        const std::string& id() const noexcept
+        {
+            return app_id;
+        }
+
+        std::string client_key() const
+        {
+            return public_key( app_key.get() );
+        }
+
+        /// <summary>
+        /// Handles a request for the specified endpoint, returning its status code and body.
+        /// </summary>
+        std::pair< int, std::string > handle( const std::string_view endpoint, const std::string_view query )
+        {
+            const auto hwid = query_parameter( query, "hwid" );
+
+            if ( endpoint == "initialize" )
+            {
+                if ( query_parameter( query, "app_id" ) != app_id )
+                    return { 404, {} };
+
+                return respond( app_key.get(), hwid, { { "dashboard_hostname", "127.0.0.1" } } );
+            }
+
+            if ( endpoint == "authenticate" )
+            {
+                if ( query_parameter( query, "app_id" ) != app_id )
+                    return { 404, {} };
+
+                std::lock_guard lock( mutex );
+
+                if ( polls[ hwid ]++ < options.auth_polls )
+                    return { 401, {} };
+
+                polls.erase( hwid );
+
+                auto session = random_hex( 16 );
+                sessions.insert( session );
+
+                const nlohmann::json user = {
+                    { "id", random_hex( 8 ) },
+                    { "name", "Stand-in User" },
+                    { "avatar", nullptr },
+                    { "subscription", { { "id", random_hex( 8 ) }, { "expires", nullptr }, { "tier", 0 } } },
+                    { "session", std::move( session ) },
+                    { "session_key", session_public_key },
+                };
+
+                return respond( app_key.get(), hwid, user );
+            }
+
+            if ( endpoint == "heartbeat" )
+            {
+                {
+                    std::lock_guard lock( mutex );
+
+                    if ( !sessions.contains( query_parameter( query, "session" ) ) )
+                        return { 401, {} };
+                }
+
+                return respond( session_key.get(), hwid, nlohmann::json::object() );
+            }
+
+            return { 404, {} };
+        }
+
+       private:
+        /// <summary>
+        /// Wraps data in a signed envelope.
+        /// </summary>
+        static std::pair< int, std::string > respond( EVP_PKEY* key, const std::string_view hwid, nlohmann::json data )
+        {
+            const nlohmann::json payload = {
+                { "data", std::move( data ) },
+                { "hwid", hwid },
+                { "timestamp", static_cast< std::uint64_t >( std::chrono::duration_cast< std::chrono::seconds >(
+                                   std::chrono::system_clock::now().time_since_epoch() ).count() ) },
+            };
+
+            const auto serialized = payload.dump();
+            const auto signature = sign( key, serialized );
+
+            if ( !signature )
+                return { 500, {} };
+
+            return { 200, nlohmann::json{ { "data", base64( serialized ) }, { "signature", base64( *signature ) } }.dump() };
+        }
+    };
+
+    static std::string_view reason( int status_code ) noexcept
+    {
+        switch ( status_code )
+        {
+            case 200: return "OK";
+            case 400: return "Bad Request";
+            case 401: return "Unauthorized";
+            case 404: return "Not Found";
+            case 405: return "Method Not Allowed";
+            case 429: return "Too Many Requests";
+            default: return "Internal Server Error";
+        }
+    }
+
+    static bool send_all( int socket, const std::string_view data ) noexcept
+    {
+        std::size_t sent = 0;
+
+        while ( sent < data.size() )
+        {
+            const auto result = ::send( socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL );
+
+            if ( result <= 0 )
+                return false;
+
+            sent += static_cast< std::size_t >( result );
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Serves the requests of one keep-alive connection.
+    /// </summary>
+    static void serve_connection( int socket, api& server, const options_t& options )
+    {
+        std::mt19937_64 random( std::random_device{}() );
+        std::uniform_real_distribution< double > chance( 0.0, 1.0 );
+
+        std::string buffer;
+        char chunk[ 4096 ];
+
+        while ( !stopping )
+        {
+            // Read until the end of the request headers. GET requests have no body.
+            auto end = buffer.find( "\r\n\r\n" );
+
+            while ( end == std::string::npos )
+            {
+                const auto received = ::recv( socket, chunk, sizeof( chunk ), 0 );
+
+                if ( received <= 0 || buffer.size() > 64 * 1024 )
+                {
+                    ::close( socket );
+                    return;
+                }
+
+                buffer.append( chunk, static_cast< std::size_t >( received ) );
+                end = buffer.find( "\r\n\r\n" );
+            }
+
+            const std::string request = buffer.substr( 0, end );
+            buffer.erase( 0, end + 4 );
+
+            ++counters.requests;
+
+            const std::string_view line( request.data(), std::min( request.find( "\r\n" ), request.size() ) );
+            const auto method_end = line.find( ' ' );
+            const auto target_end = line.find( ' ', method_end + 1 );
+
+            if ( method_end == std::string_view::npos || target_end == std::string_view::npos )
+            {
+                ::close( socket );
+                return;
+            }
+
+            const auto method = line.substr( 0, method_end );
+            const auto target = line.substr( method_end + 1, target_end - method_end - 1 );
+
+            const auto query_start = std::min( target.find( '?' ), target.size() );
+            const auto path = target.substr( 0, query_start );
+            const auto query = target.substr( std::min( query_start + 1, target.size() ) );
+            const auto endpoint = path.substr( path.rfind( '/' ) + 1 );
+
+            if ( options.latency.count() || options.jitter.count() )
+            {
+                const auto jitter = std::chrono::duration< double, std::milli >( options.jitter ) * chance( random );
+                std::this_thread::sleep_for( options.latency + jitter );
+            }
+
+            if ( chance( random ) < options.drop )
+            {
+                ++counters.dropped;
+                ::close( socket );
+                return;
+            }
+
+            int status_code = 0;
+            std::string body, headers;
+
+            if ( method != "GET" )
+                status_code = 405;
+            else if ( chance( random ) < options.rate_limit )
+            {
+                ++counters.rate_limited;
+                status_code = 429;
+
+                if ( options.retry_after )
+                    headers = "Retry-After: " + std::to_string( options.retry_after ) + "\r\n";
+            }
+            else
+                std::tie( status_code, body ) = server.handle( endpoint, query );
+
+            if ( !options.quiet )
+                std::clog << status_code << ' ' << path << '\n';
+
+            const auto response = "HTTP/1.1 " + std::to_string( status_code ) + ' ' + std::string( reason( status_code ) ) +
+                                  "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string( body.size() ) + "\r\n" + headers + "\r\n" +
+                                  body;
+
+            if ( !send_all( socket, response ) )
+                break;
+        }
+
+        ::close( socket );
+    }
+
+    static int listen_on( const options_t& options, int type, std::uint16_t port )
+    {
+        const auto socket = ::socket( AF_INET, type, 0 );
+
+        if ( socket < 0 )
+            return -1;
+
+        const int enable = 1;
+        setsockopt( socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof( enable ) );
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons( port );
+
+        if ( inet_pton( AF_INET, options.bind.c_str(), &address.sin_addr ) != 1 ||
+             bind( socket, reinterpret_cast< sockaddr* >( &address ), sizeof( address ) ) < 0 || ( type == SOCK_STREAM && listen( socket, 512 ) < 0 ) )
+        {
+            ::close( socket );
+            return -1;
+        }
+
+        return socket;
+    }
+
+    /// <summary>
+    /// Answers SNTP requests with the local time.
+    /// </summary>
+    static void serve_ntp( int socket )
+    {
+        constexpr std::uint64_t ntp_delta = 2208988800ull;
+
+        const auto timestamp = []( std::uint32_t* out )
+        {
+            const auto now = std::chrono::system_clock::now().time_since_epoch();
+            const auto seconds = std::chrono::duration_cast< std::chrono::seconds >( now );
+            const auto fraction = std::chrono::duration_cast< std::chrono::nanoseconds >( now - seconds ).count();
+
+            out[ 0 ] = htonl( static_cast< std::uint32_t >( seconds.count() + ntp_delta ) );
+            out[ 1 ] = htonl( static_cast< std::uint32_t >( ( static_cast< std::uint64_t >( fraction ) << 32 ) / 1000000000ull ) );
+        };
+
+        while ( !stopping )
+        {
+            std::uint32_t packet[ 12 ];
+            sockaddr_in peer{};
+            socklen_t peer_size = sizeof( peer );
+
+            const auto received = recvfrom( socket, packet, sizeof( packet ), 0, reinterpret_cast< sockaddr* >( &peer ), &peer_size );
+
+            if ( received < static_cast< ssize_t >( sizeof( packet ) ) )
+                continue;
+
+            ++counters.ntp;
+
+            std::uint32_t receive[ 2 ];
+            timestamp( receive );
+
+            // Leap indicator 0, the version of the request, server mode. Stratum 1 with a local reference clock.
+            const auto version = ( reinterpret_cast< std::uint8_t* >( packet )[ 0 ] >> 3 ) & 0x7;
+            const std::uint32_t header = static_cast< std::uint32_t >( version << 3 | 4 ) << 24 | 1u << 16 | 0xEC;
+
+            packet[ 0 ] = htonl( header );
+            packet[ 1 ] = packet[ 2 ] = 0;
+            std::memcpy( &packet[ 3 ], "LOCL", 4 );
+
+            // The transmit time of the request becomes the originate time of the response.
+            packet[ 6 ] = packet[ 10 ];
+            packet[ 7 ] = packet[ 11 ];
+            packet[ 4 ] = packet[ 8 ] = receive[ 0 ];
+            packet[ 5 ] = packet[ 9 ] = receive[ 1 ];
+            timestamp( &packet[ 10 ] );
+
+            sendto( socket, packet, sizeof( packet ), 0, reinterpret_cast< sockaddr* >( &peer ), peer_size );
+        }
+    }
+
+    static void usage()
+    {
+        std::cerr << "Usage: standin [options]\n"
+                     "  --bind <address>        Address to listen on (default 127.0.0.1)\n"
+                     "  --port <port>           HTTP port of the API (default 8080)\n"
+                     "  --ntp-port <port>       UDP port of the NTP server (default 1230)\n"
+                     "  --latency <ms>          Delay added to every response\n"
+                     "  --jitter <ms>           Random delay of up to this long added on top of the latency\n"
+                     "  --rate-limit <p>        Probability of answering with 429 Too Many Requests\n"
+                     "  --retry-after <s>       Retry-After of rate limited responses, 0 to omit it (default 1)\n"
+                     "  --drop <p>              Probability of closing the connection instead of answering\n"
+                     "  --auth-polls <n>        Authentication requests answered with 401 before a login succeeds\n"
+                     "  --quiet                 Do not log requests\n";
+    }
+
+    template< typename T >
+    static bool parse_number( const std::string_view text, T& value ) noexcept
+    {
+        return std::from_chars( text.data(), text.data() + text.size(), value ).ec == std::errc{};
+    }
+
+    static std::optional< options_t > parse_options( int argc, char** argv )
+    {
+        options_t options;
+
+        for ( int i = 1; i < argc; ++i )
+        {
+            const std::string_view name = argv[ i ];
+
+            if ( name == "--quiet" )
+            {
+                options.quiet = true;
+                continue;
+            }
+
+            if ( i + 1 >= argc )
+                return std::nullopt;
+
+            const std::string_view value = argv[ ++i ];
+            std::int64_t milliseconds = 0;
+
+            bool ok = true;
+
+            if ( name == "--bind" )
+                options.bind = value;
+            else if ( name == "--port" )
+                ok = parse_number( value, options.http_port );
+            else if ( name == "--ntp-port" )
+                ok = parse_number( value, options.ntp_port );
+            else if ( name == "--latency" && ( ok = parse_number( value, milliseconds ) ) )
+                options.latency = std::chrono::milliseconds( milliseconds );
+            else if ( name == "--jitter" && ( ok = parse_number( value, milliseconds ) ) )
+                options.jitter = std::chrono::milliseconds( milliseconds );
+            else if ( name == "--rate-limit" )
+                ok = parse_number( value, options.rate_limit );
+            else if ( name == "--retry-after" )
+                ok = parse_number( value, options.retry_after );
+            else if ( name == "--drop" )
+                ok = parse_number( value, options.drop );
+            else if ( name == "--auth-polls" )
+                ok = parse_number( value, options.auth_polls );
+            else
+                ok = false;
+
+            if ( !ok )
+                return std::nullopt;
+        }
+
+        return options;
+    }
+}  // namespace standin
+
+int main( int argc, char** argv )
+{
+    using namespace standin;
+
+    const auto options = parse_options( argc, argv );
+
+    if ( !options )
+    {
+        usage();
+        return 1;
+    }
+
+    api server( *options );
+
+    if ( !server )
+    {
+        std::cerr << "Failed to generate the signing keys.\n";
+        return 1;
+    }
+
+    const auto http_socket = listen_on( *options, SOCK_STREAM, options->http_port );
+    const auto ntp_socket = listen_on( *options, SOCK_DGRAM, options->ntp_port );
+
+    if ( http_socket < 0 || ntp_socket < 0 )
+    {
+        std::cerr << "Failed to listen on " << options->bind << ".\n";
+        return 1;
+    }
+
+    std::cout << "App ID:     " << server.id() << '\n'
+              << "Client key: " << server.client_key() << '\n'
+              << "API URL:    http://" << options->bind << ':' << options->http_port << "/api/client\n"
+              << "NTP server: " << options->bind << ':' << options->ntp_port << '\n'
+              << std::endl;
+
+    // Without SA_RESTART, a signal interrupts the blocking accept so that the counters are printed on exit.
+    struct sigaction action{};
+    action.sa_handler = []( int ) { stopping = true; };
+
+    sigaction( SIGINT, &action, nullptr );
+    sigaction( SIGTERM, &action, nullptr );
+
+    std::thread( serve_ntp, ntp_socket ).detach();
+
+    while ( !stopping )
+    {
+        const auto socket = accept( http_socket, nullptr, nullptr );
+
+        if ( socket < 0 )
+            continue;
+
+        const int enable = 1;
+        setsockopt( socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof( enable ) );
+
+        std::thread( serve_connection, socket, std::ref( server ), std::cref( *options ) ).detach();
+    }
+
+    std::cout << "Requests: " << counters.requests << ", rate limited: " << counters.rate_limited << ", dropped: " << counters.dropped
+              << ", NTP: " << counters.ntp << std::endl;
+
+    return 0;
+}